@@ -0,0 +1,400 @@
+//-------------------------------------------------------
+// Filename: batchmain.cpp
+//
+// Description: Command line evaluator. Loads a joints
+//              file, plays a macro through it and writes
+//              the world matrices of every frame, without
+//              any window or GL context.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cstdio>
+#include "xmlreader.h"
+#include "macro.h"
+#include "ik.h"
+#include "kinematics.h"
+#include "trace.h"
+#include "workspace.h"
+
+namespace {
+
+const char FRAMES_MAGIC[8] = {'S', 'R', 'F', 'R', 'A', 'M', 'E', 'S'};
+
+//Same layout as MainWindow::show_matrix: rotation in the top left,
+//translation in the last column, row by row
+void frame_matrix(const Frame &f, double m[16])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            m[4*i+j] = f.r[j][i];
+        m[4*i+3] = f.t[i];
+    }
+    m[12] = m[13] = m[14] = 0;
+    m[15] = 1;
+}
+
+class FrameWriter
+{
+public:
+    FrameWriter(QFile &file, bool binary, quint32 rows, quint64 frames):
+        mFile(file),
+        mText(&file),
+        mBinary{binary}
+    {
+        if (mBinary)
+        {
+            //magic, version, matrices per frame, frame count
+            quint32 version = 1;
+            mFile.write(FRAMES_MAGIC, sizeof(FRAMES_MAGIC));
+            mFile.write(reinterpret_cast<const char*>(&version), sizeof(version));
+            mFile.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+            mFile.write(reinterpret_cast<const char*>(&frames), sizeof(frames));
+        }
+        else
+        {
+            mText.setRealNumberPrecision(17);
+            mText << "frame,joint";
+            for (int i = 0; i < 4; i++)
+                for (int j = 0; j < 4; j++)
+                    mText << ",m" << i << j;
+            mText << "\n";
+        }
+    }
+
+    void write(std::size_t frame, std::size_t joint, const Frame &f)
+    {
+        double m[16];
+        frame_matrix(f, m);
+        if (mBinary)
+        {
+            mFile.write(reinterpret_cast<const char*>(m), sizeof(m));
+            return;
+        }
+        mText << frame << "," << joint;
+        for (int k = 0; k < 16; k++)
+            mText << "," << m[k];
+        mText << "\n";
+    }
+
+    bool finish()
+    {
+        if (!mBinary)
+            mText.flush();
+        return mFile.error() == QFile::NoError && mText.status() == QTextStream::Ok;
+    }
+
+private:
+    QFile &mFile;
+    QTextStream mText;
+    bool mBinary;
+};
+
+//Inverse of frame_matrix
+Frame matrix_frame(const double m[16])
+{
+    Frame f;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            f.r[j][i] = m[4*i+j];
+        f.t[i] = m[4*i+3];
+    }
+    return f;
+}
+
+//One target per line, values separated by commas or spaces: x y z for a
+//position, or the 16 values of a matrix in the layout this tool writes for a
+//full pose. Lines starting with # are skipped.
+bool read_targets(const QString &filename, std::vector<IkTarget> &targets, QString &error)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+    {
+        error = "Cannot read " + filename;
+        return false;
+    }
+    QTextStream in(&file);
+    for (int number = 1; !in.atEnd(); number++)
+    {
+        QString line = in.readLine().replace(',', ' ').simplified();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        QStringList fields = line.split(' ');
+        if (fields.size() != 3 && fields.size() != 16)
+        {
+            error = QString("Line %1: expected 3 or 16 values, found %2").arg(number).arg(fields.size());
+            return false;
+        }
+        double m[16];
+        for (int k = 0; k < fields.size(); k++)
+        {
+            bool ok;
+            m[k] = fields[k].toDouble(&ok);
+            if (!ok)
+            {
+                error = QString("Line %1: %2 is not a number").arg(number).arg(fields[k]);
+                return false;
+            }
+        }
+
+        IkTarget target;
+        if (fields.size() == 3)
+            target.pose = translate_frame(m[0], m[1], m[2]);
+        else
+        {
+            target.pose = matrix_frame(m);
+            target.use_orientation = true;
+        }
+        targets.push_back(target);
+    }
+    return true;
+}
+
+//Solves every target from the joints' current pose and writes one CSV row per target
+int run_ik(const JointStore &joints, const QString &target_file, const IkOptions &options, const QString &output)
+{
+    std::vector<IkTarget> targets;
+    QString error;
+    if (!read_targets(target_file, targets, error))
+    {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(target_file), qPrintable(error));
+        return 1;
+    }
+
+    std::vector<IkResult> results;
+    IkStats stats = IkSolver(joints.chain(), options).solve_batch(targets, results);
+    std::fprintf(stderr, "%zu targets, %zu converged, %.1f mean and %d max iterations, "
+                 "%g max position error, %.3f s on %u threads\n",
+                 stats.targets, stats.converged, stats.mean_iterations, stats.max_iterations,
+                 stats.max_position_error, stats.seconds, stats.threads);
+
+    QFile file(output);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+    {
+        std::fprintf(stderr, "Cannot write %s\n", qPrintable(output));
+        return 1;
+    }
+    QTextStream out(&file);
+    out.setRealNumberPrecision(17);
+    out << "target,converged,iterations,position_error,orientation_error";
+    for (std::size_t i = 0; i < joints.size(); i++)
+        out << ",u" << i << ",v" << i;
+    out << "\n";
+    for (std::size_t k = 0; k < results.size(); k++)
+    {
+        const IkResult &r = results[k];
+        out << k << "," << (r.converged ? 1 : 0) << "," << r.iterations << ","
+            << r.position_error << "," << r.orientation_error;
+        for (std::size_t i = 0; i < r.u.size(); i++)
+            out << "," << r.u[i] << "," << r.v[i];
+        out << "\n";
+    }
+    out.flush();
+    if (file.error() != QFile::NoError || out.status() != QTextStream::Ok)
+    {
+        std::fprintf(stderr, "Error writing %s\n", qPrintable(output));
+        return 1;
+    }
+    return 0;
+}
+
+//Samples the workspace of the joints and writes the voxel grid
+int run_workspace(const JointStore &joints, const WorkspaceOptions &options, double voxel_size, const QString &output)
+{
+    if (!(voxel_size > 0))
+    {
+        std::fprintf(stderr, "Voxel size must be positive\n");
+        return 1;
+    }
+    VoxelGrid grid(voxel_size);
+    WorkspaceStats stats = sample_workspace(joints, options, grid);
+    std::fprintf(stderr, "%llu samples, %llu points in %zu voxels, %.3f s on %u threads\n",
+                 (unsigned long long)stats.samples, (unsigned long long)stats.points, stats.voxels,
+                 stats.seconds, stats.threads);
+
+    if (!grid.write(output.toStdString(), stats.samples))
+    {
+        std::fprintf(stderr, "Error writing %s\n", qPrintable(output));
+        return 1;
+    }
+    return 0;
+}
+
+int run(QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Plays a macro through a joints file and writes the world matrix of every frame.\n"
+                                     "Binary output is a header (8 byte magic SRFRAMES, uint32 version, uint32 matrices\n"
+                                     "per frame, uint64 frames) followed by 16 doubles per matrix, little-endian.\n"
+                                     "With --ik, solves for the (u, v) of every joint instead and writes one CSV row per target.\n"
+                                     "With --workspace, samples random poses within the joint limits and writes a voxel grid.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("joints", "Joints XML file");
+    parser.addPositionalArgument("output", "Output file");
+    QCommandLineOption macro_option("macro", "Macro to play, text or binary. Without one only the file's pose is written.", "file");
+    QCommandLineOption format_option("format", "csv or binary, the default comes from the output extension.", "format");
+    QCommandLineOption joints_option("all-joints", "Write the end frame of every joint, not just the end effector.");
+    QCommandLineOption ik_option("ik", "Targets to solve for, one per line: x y z, or 16 matrix values for a full pose.", "file");
+    QCommandLineOption iterations_option("max-iterations", "Most IK iterations per target.", "count", "100");
+    QCommandLineOption tolerance_option("tolerance", "IK position and orientation error to stop at.", "value", "1e-4");
+    QCommandLineOption workspace_option("workspace", "Random poses to sample into a voxel grid.", "samples");
+    QCommandLineOption voxel_option("voxel-size", "Edge length of a workspace voxel.", "size", "1");
+    QCommandLineOption seed_option("seed", "Workspace random seed.", "seed", "1");
+    QCommandLineOption end_option("end-only", "Only bin the end effector, not every collision sphere.");
+    QCommandLineOption threads_option("threads", "Threads for --ik and --workspace, 0 for every core.", "count", "0");
+    parser.addOption(macro_option);
+    parser.addOption(format_option);
+    parser.addOption(joints_option);
+    parser.addOption(ik_option);
+    parser.addOption(iterations_option);
+    parser.addOption(tolerance_option);
+    parser.addOption(workspace_option);
+    parser.addOption(voxel_option);
+    parser.addOption(seed_option);
+    parser.addOption(end_option);
+    parser.addOption(threads_option);
+    parser.process(app);
+
+    QStringList args = parser.positionalArguments();
+    if (args.size() != 2)
+        parser.showHelp(1);
+
+    QFile xml(args[0]);
+    if (!xml.open(QFile::ReadOnly | QFile::Text))
+    {
+        std::fprintf(stderr, "Cannot read %s\n", qPrintable(args[0]));
+        return 1;
+    }
+    JointStore joints;
+    XmlReader reader(joints);
+    if (!reader.read(&xml))
+    {
+        std::fprintf(stderr, "Parse error in %s\n%s\n", qPrintable(args[0]), qPrintable(reader.errorString()));
+        return 1;
+    }
+    if (joints.empty())
+    {
+        std::fprintf(stderr, "%s has no joints\n", qPrintable(args[0]));
+        return 1;
+    }
+
+    if (int(parser.isSet(macro_option)) + int(parser.isSet(ik_option)) + int(parser.isSet(workspace_option)) > 1)
+    {
+        std::fprintf(stderr, "Use only one of --macro, --ik and --workspace\n");
+        return 1;
+    }
+    if (parser.isSet(workspace_option))
+    {
+        WorkspaceOptions options;
+        bool ok;
+        options.samples = parser.value(workspace_option).toULongLong(&ok);
+        if (!ok)
+        {
+            std::fprintf(stderr, "Bad sample count %s\n", qPrintable(parser.value(workspace_option)));
+            return 1;
+        }
+        options.include_spheres = !parser.isSet(end_option);
+        options.seed = parser.value(seed_option).toULongLong();
+        options.threads = parser.value(threads_option).toUInt();
+        return run_workspace(joints, options, parser.value(voxel_option).toDouble(), args[1]);
+    }
+    if (parser.isSet(ik_option))
+    {
+        IkOptions options;
+        options.max_iterations = std::max(1, parser.value(iterations_option).toInt());
+        options.tolerance = parser.value(tolerance_option).toDouble();
+        options.threads = parser.value(threads_option).toUInt();
+        return run_ik(joints, parser.value(ik_option), options, args[1]);
+    }
+
+    Macro macro;
+    if (parser.isSet(macro_option))
+    {
+        if (!macro.load(parser.value(macro_option)))
+        {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(parser.value(macro_option)), qPrintable(macro.error_string()));
+            return 1;
+        }
+        macro.set_initial_lines(joints.size());
+    }
+
+    QString format = parser.value(format_option);
+    if (format.isEmpty())
+        format = args[1].endsWith(".csv", Qt::CaseInsensitive) ? "csv" : "binary";
+    if (format != "csv" && format != "binary")
+    {
+        std::fprintf(stderr, "Unknown format %s\n", qPrintable(format));
+        return 1;
+    }
+    bool binary = format == "binary";
+    bool all_joints = parser.isSet(joints_option);
+
+    QFile out(args[1]);
+    if (!out.open(binary ? QFile::WriteOnly | QFile::Truncate : QFile::WriteOnly | QFile::Truncate | QFile::Text))
+    {
+        std::fprintf(stderr, "Cannot write %s\n", qPrintable(args[1]));
+        return 1;
+    }
+
+    //A file without a macro is a single frame in its saved pose
+    std::size_t frames = std::max<std::size_t>(1, macro.frame_count());
+    std::size_t n = joints.size();
+    FrameWriter writer(out, binary, all_joints ? n : 1, frames);
+    FrameCache cache;
+    const Chain &chain = joints.chain();
+
+    for (std::size_t f = 0; f < frames; f++)
+    {
+        if (macro.frame_count() > 0)
+        {
+            std::size_t first, last;
+            macro.frame_lines(f, first, last);
+            for (std::size_t k = first; k < last; k++)
+            {
+                const MacroLine &line = macro.line(k);
+                if (line.joint >= n)
+                    continue;
+                joints.set_axis(line.joint, line.u, line.v);
+                cache.invalidate(line.joint);
+            }
+        }
+
+        if (all_joints)
+        {
+            for (std::size_t i = 0; i < n; i++)
+                writer.write(f, i, cache.end_frame(chain, i));
+        }
+        else
+            writer.write(f, n-1, cache.end_effector(chain));
+    }
+
+    if (!writer.finish())
+    {
+        std::fprintf(stderr, "Error writing %s\n", qPrintable(args[1]));
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("softrobot_batch");
+
+    //Every exit goes through here, so a failed run still writes its trace
+    trace_start_from_environment();
+    int result = run(app);
+    trace_finish_from_environment();
+    return result;
+}
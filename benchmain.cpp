@@ -0,0 +1,405 @@
+//-------------------------------------------------------
+// Filename: benchmain.cpp
+//
+// Description: Scaling benchmarks for the joint nodes,
+//              the scene build and the joints file, run
+//              over synthetic chains of growing length.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+
+#include <QApplication>
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "jointstore.h"
+#include "joint.h"
+#include "osgwidget.h"
+#include "xmlloader.h"
+#include "xmlreader.h"
+#include "xmlwriter.h"
+
+namespace {
+
+struct Result
+{
+    QString name;
+    std::size_t joints;
+    int repeats;
+    double min_ms;
+    double median_ms;
+    double mean_ms;
+    double max_ms;
+};
+
+//A smooth, repeatable chain: every joint bends a little, in a direction that
+//turns along the chain, so no two neighbours are the same
+void make_chain(std::size_t n, JointStore &joints)
+{
+    joints.clear();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        joints.push_back(static_cast<int>(i), 5, 1);
+        joints.set_axis(i, .2*std::sin(.37*i), .2*std::cos(.23*i));
+        joints.set_color(i, i%256, (3*i)%256, (7*i)%256);
+    }
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Result summarize(const QString &name, std::size_t joints, std::vector<double> times)
+{
+    Result r;
+    r.name = name;
+    r.joints = joints;
+    r.repeats = static_cast<int>(times.size());
+    if (times.empty())
+        times.push_back(0);
+    std::sort(times.begin(), times.end());
+    r.min_ms = times.front();
+    r.median_ms = times[times.size()/2];
+    double total = 0;
+    for (std::size_t k = 0; k < times.size(); k++)
+        total += times[k];
+    r.mean_ms = total/times.size();
+    r.max_ms = times.back();
+    return r;
+}
+
+//Runs body until min_ms have been spent or max_repeats runs are done, at least
+//once. setup runs before each repeat and is not timed.
+Result measure(const QString &name, std::size_t joints, double min_ms, int max_repeats,
+               const std::function<void()> &setup, const std::function<void()> &body)
+{
+    std::vector<double> times;
+    double total = 0;
+    while (times.empty() || (total < min_ms && int(times.size()) < max_repeats))
+    {
+        setup();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        body();
+        double ms = elapsed_ms(start);
+        times.push_back(ms);
+        total += ms;
+    }
+    return summarize(name, joints, times);
+}
+
+//Asks for one frame and waits until it has been drawn, on whichever thread
+//draws. False if none came within a second, as without an OpenGL context.
+bool draw_frame(OSGWidget &widget)
+{
+    QEventLoop loop;
+    bool drawn = false;
+    QObject::connect(&widget, &OSGWidget::frame_drawn, &loop, [&]{
+        drawn = true;
+        loop.quit();
+    });
+    QTimer::singleShot(1000, &loop, SLOT(quit()));
+    widget.request_redraw();
+    loop.exec();
+    return drawn;
+}
+
+//Keeps frames coming for min_ms and times the gaps between the ticks of a
+//1 ms timer on the GUI thread, which is how long input waits while drawing
+Result gui_gaps(const QString &name, std::size_t joints, double min_ms, OSGWidget &widget)
+{
+    std::vector<double> gaps;
+    QEventLoop loop;
+    QElapsedTimer clock;
+    QTimer tick;
+    tick.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&tick, &QTimer::timeout, &loop, [&]{
+        gaps.push_back(clock.nsecsElapsed()/1e6);
+        clock.start();
+    });
+    QObject::connect(&widget, &OSGWidget::frame_drawn, &loop, [&]{ widget.request_redraw(); });
+    QTimer::singleShot(int(std::max(min_ms, 500.0)), &loop, SLOT(quit()));
+    clock.start();
+    tick.start(1);
+    widget.request_redraw();
+    loop.exec();
+    tick.stop();
+    return summarize(name, joints, gaps);
+}
+
+void write_csv(QTextStream &out, const std::vector<Result> &results)
+{
+    out << "benchmark,joints,repeats,min_ms,median_ms,mean_ms,max_ms,ns_per_joint\n";
+    for (std::size_t k = 0; k < results.size(); k++)
+    {
+        const Result &r = results[k];
+        out << r.name << "," << r.joints << "," << r.repeats << "," << r.min_ms << ","
+            << r.median_ms << "," << r.mean_ms << "," << r.max_ms << "," << 1e6*r.median_ms/r.joints << "\n";
+    }
+}
+
+void write_json(QTextStream &out, const std::vector<Result> &results)
+{
+    out << "{\"benchmarks\": [\n";
+    for (std::size_t k = 0; k < results.size(); k++)
+    {
+        const Result &r = results[k];
+        out << "  {\"name\": \"" << r.name << "\", \"joints\": " << r.joints << ", \"repeats\": " << r.repeats
+            << ", \"min_ms\": " << r.min_ms << ", \"median_ms\": " << r.median_ms << ", \"mean_ms\": " << r.mean_ms
+            << ", \"max_ms\": " << r.max_ms << ", \"ns_per_joint\": " << 1e6*r.median_ms/r.joints << "}" << (k+1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    //Only the render benchmarks show the scene, and they draw offscreen too
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the joint nodes, the scene build, the joints file and drawing on synthetic chains.");
+    parser.addHelpOption();
+    QCommandLineOption sizes_option("sizes", "Comma separated chain lengths.", "list", "10,100,1000,10000,100000");
+    QCommandLineOption format_option("format", "csv or json.", "format", "csv");
+    QCommandLineOption output_option("output", "Write results here instead of stdout.", "file");
+    QCommandLineOption filter_option("filter", "Only run benchmarks whose name contains this.", "text");
+    QCommandLineOption time_option("min-time", "Milliseconds to spend on each benchmark and size.", "ms", "200");
+    QCommandLineOption repeat_option("max-repeats", "Most runs of each benchmark and size.", "count", "1000");
+    QCommandLineOption layout_option("layout", "Joint layout for the scene benchmarks: auto, flat or nested.", "layout", "auto");
+    parser.addOption(sizes_option);
+    parser.addOption(format_option);
+    parser.addOption(output_option);
+    parser.addOption(filter_option);
+    parser.addOption(time_option);
+    parser.addOption(repeat_option);
+    parser.addOption(layout_option);
+    parser.process(app);
+
+    std::vector<std::size_t> sizes;
+    QStringList size_list = parser.value(sizes_option).split(',');
+    for (int k = 0; k < size_list.size(); k++)
+    {
+        if (size_list[k].isEmpty())
+            continue;
+        bool ok;
+        unsigned long n = size_list[k].toULong(&ok);
+        if (!ok || n == 0)
+        {
+            std::fprintf(stderr, "Bad chain length %s\n", qPrintable(size_list[k]));
+            return 1;
+        }
+        sizes.push_back(n);
+    }
+
+    QString format = parser.value(format_option);
+    if (format != "csv" && format != "json")
+    {
+        std::fprintf(stderr, "Unknown format %s\n", qPrintable(format));
+        return 1;
+    }
+    QString layout_name = parser.value(layout_option);
+    JointLayout layout = LAYOUT_AUTO;
+    if (layout_name == "flat")
+        layout = LAYOUT_FLAT;
+    else if (layout_name == "nested")
+        layout = LAYOUT_NESTED;
+    else if (layout_name != "auto")
+    {
+        std::fprintf(stderr, "Unknown layout %s\n", qPrintable(layout_name));
+        return 1;
+    }
+    QString filter = parser.value(filter_option);
+    double min_ms = parser.value(time_option).toDouble();
+    int max_repeats = std::max(1, parser.value(repeat_option).toInt());
+
+    std::vector<Result> results;
+    JointStore joints;
+    OSGWidget widget;
+    std::function<void()> nothing = []{};
+    auto wanted = [&](const QString &name) { return filter.isEmpty() || name.contains(filter); };
+
+    for (std::size_t s = 0; s < sizes.size(); s++)
+    {
+        std::size_t n = sizes[s];
+        make_chain(n, joints);
+        std::fprintf(stderr, "%zu joints\n", n);
+
+        if (wanted("joint_update_T") || wanted("joint_set_size"))
+        {
+            //The nodes are owned by the group, as they would be by the scene
+            osg::ref_ptr<osg::Group> holder = new osg::Group;
+            std::vector<Joint*> nodes;
+            for (std::size_t i = 0; i < n; i++)
+            {
+                nodes.push_back(new Joint(&joints, joints.handle(i)));
+                holder->addChild(nodes.back()->get_T());
+            }
+            if (wanted("joint_update_T"))
+            {
+                results.push_back(measure("joint_update_T", n, min_ms, max_repeats, nothing, [&]{
+                    for (std::size_t i = 0; i < n; i++)
+                        nodes[i]->update_T();
+                }));
+            }
+            if (wanted("joint_set_size"))
+            {
+                results.push_back(measure("joint_set_size", n, min_ms, max_repeats, nothing, [&]{
+                    for (std::size_t i = 0; i < n; i++)
+                        nodes[i]->set_size(5, 1);
+                }));
+            }
+            for (std::size_t i = 0; i < n; i++)
+                delete nodes[i];
+        }
+
+        if (wanted("open_arm") || wanted("change_joint_config"))
+        {
+            widget.reset();
+            widget.set_joint_layout(layout, joints);
+            if (wanted("open_arm"))
+            {
+                results.push_back(measure("open_arm", n, min_ms, max_repeats, [&]{ widget.reset(); }, [&]{
+                    widget.open_arm(joints);
+                }));
+            }
+            else
+                widget.open_arm(joints);
+
+            if (wanted("change_joint_config"))
+            {
+                //The first joint is the worst case, everything after it moves
+                double sign = 1;
+                results.push_back(measure("change_joint_config", n, min_ms, max_repeats, [&]{
+                    sign = -sign;
+                    joints.set_axis(0, .1*sign, .1);
+                }, [&]{
+                    widget.change_joint_config(0, joints);
+                }));
+            }
+            widget.reset();
+        }
+
+        if (wanted("render_frame") || wanted("render_frame_thread") || wanted("gui_gap") || wanted("gui_gap_thread"))
+        {
+            //The same frames drawn on the GUI thread and then on the render
+            //thread, timed from the request to the end of the draw
+            widget.reset();
+            widget.set_joint_layout(layout, joints);
+            widget.open_arm(joints);
+            widget.set_frame_budget(0);
+            widget.resize(640, 480);
+            widget.show();
+            if (!draw_frame(widget))
+                std::fprintf(stderr, "No frame was drawn, render benchmarks skipped\n");
+            else
+            {
+                for (int threaded = 0; threaded < 2; threaded++)
+                {
+                    widget.set_render_thread(threaded != 0);
+                    QString suffix = threaded ? "_thread" : "";
+                    if (wanted("render_frame" + suffix))
+                    {
+                        results.push_back(measure("render_frame" + suffix, n, min_ms, max_repeats, nothing, [&]{
+                            draw_frame(widget);
+                        }));
+                    }
+                    if (wanted("gui_gap" + suffix))
+                        results.push_back(gui_gaps("gui_gap" + suffix, n, min_ms, widget));
+                }
+                widget.set_render_thread(false);
+            }
+            widget.hide();
+            widget.reset();
+        }
+
+        if (wanted("xml_write") || wanted("xml_read") || wanted("xml_load"))
+        {
+            QByteArray xml;
+            QBuffer buffer(&xml);
+            buffer.open(QBuffer::WriteOnly);
+            XmlWriter(joints).write(&buffer);
+            buffer.close();
+
+            if (wanted("xml_write"))
+            {
+                results.push_back(measure("xml_write", n, min_ms, max_repeats, nothing, [&]{
+                    QByteArray out;
+                    out.reserve(xml.size());
+                    QBuffer target(&out);
+                    target.open(QBuffer::WriteOnly);
+                    XmlWriter(joints).write(&target);
+                }));
+            }
+
+            if (wanted("xml_read"))
+            {
+                JointStore loaded;
+                results.push_back(measure("xml_read", n, min_ms, max_repeats, [&]{ loaded.clear(); }, [&]{
+                    QBuffer source(&xml);
+                    source.open(QBuffer::ReadOnly);
+                    XmlReader reader(loaded);
+                    reader.read(&source);
+                }));
+                if (loaded.size() != n)
+                {
+                    std::fprintf(stderr, "xml_read loaded %zu of %zu joints\n", loaded.size(), n);
+                    return 1;
+                }
+            }
+
+            if (wanted("xml_load"))
+            {
+                JointStore loaded;
+                XmlLoadStatus status = XML_LOAD_OK;
+                results.push_back(measure("xml_load", n, min_ms, max_repeats, [&]{ loaded.clear(); }, [&]{
+                    XmlLoader loader(loaded);
+                    status = loader.load(xml.constData(), xml.size());
+                }));
+                if (status != XML_LOAD_OK || loaded.size() != n)
+                {
+                    std::fprintf(stderr, "xml_load loaded %zu of %zu joints\n", loaded.size(), n);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    QFile file;
+    if (parser.isSet(output_option))
+    {
+        file.setFileName(parser.value(output_option));
+        if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+        {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+    }
+    else
+        file.open(stdout, QFile::WriteOnly | QFile::Text);
+
+    QTextStream out(&file);
+    out.setRealNumberPrecision(6);
+    if (format == "json")
+        write_json(out, results);
+    else
+        write_csv(out, results);
+    out.flush();
+    return file.error() == QFile::NoError ? 0 : 1;
+}
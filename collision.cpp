@@ -0,0 +1,355 @@
+//-------------------------------------------------------
+// Filename: collision.cpp
+//
+// Description: Collision checking of the chain's spheres
+//              against static obstacles.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "collision.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+const std::size_t LEAF_SIZE = 4;
+const double DEG_TO_RAD = 3.14159265358979323846/180.0;
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Local bounding box of a shape, see ObstacleShape for the conventions
+void local_bounds(const Obstacle &o, double lo[3], double hi[3])
+{
+    switch (o.shape)
+    {
+    case SHAPE_BOX:
+        lo[0] = -o.size[0]/2; hi[0] = o.size[0]/2;
+        lo[1] = -o.size[1]/2; hi[1] = o.size[1]/2;
+        lo[2] = 0; hi[2] = o.size[2];
+        break;
+    case SHAPE_SPHERE:
+        lo[0] = lo[1] = -o.size[0]; hi[0] = hi[1] = o.size[0];
+        lo[2] = 0; hi[2] = 2*o.size[0];
+        break;
+    default:
+        lo[0] = lo[1] = -o.size[1]; hi[0] = hi[1] = o.size[1];
+        lo[2] = 0; hi[2] = o.size[0];
+        break;
+    }
+}
+
+//Distance from (x, z) to the segment (ax, az)-(bx, bz)
+double segment_distance(double x, double z, double ax, double az, double bx, double bz)
+{
+    double dx = bx - ax;
+    double dz = bz - az;
+    double t = ((x - ax)*dx + (z - az)*dz)/(dx*dx + dz*dz);
+    t = std::max(0.0, std::min(1.0, t));
+    double ex = x - (ax + t*dx);
+    double ez = z - (az + t*dz);
+    return std::sqrt(ex*ex + ez*ez);
+}
+
+//Signed distance from a local point to the shape surface, negative inside
+double signed_distance(const Obstacle &o, const double p[3])
+{
+    switch (o.shape)
+    {
+    case SHAPE_BOX:
+    {
+        double q[3] = {std::abs(p[0]) - o.size[0]/2, std::abs(p[1]) - o.size[1]/2, std::abs(p[2] - o.size[2]/2) - o.size[2]/2};
+        double out = 0;
+        for (int k = 0; k < 3; k++)
+            out += std::max(q[k], 0.0)*std::max(q[k], 0.0);
+        return std::sqrt(out) + std::min(std::max(q[0], std::max(q[1], q[2])), 0.0);
+    }
+    case SHAPE_SPHERE:
+    {
+        double dz = p[2] - o.size[0];
+        return std::sqrt(p[0]*p[0] + p[1]*p[1] + dz*dz) - o.size[0];
+    }
+    case SHAPE_CYLINDER:
+    {
+        //Solids of revolution reduce to their (radius, height) profile
+        double rho = std::sqrt(p[0]*p[0] + p[1]*p[1]);
+        double dr = rho - o.size[1];
+        double dz = std::max(-p[2], p[2] - o.size[0]);
+        double out = std::sqrt(std::max(dr, 0.0)*std::max(dr, 0.0) + std::max(dz, 0.0)*std::max(dz, 0.0));
+        return out + std::min(std::max(dr, dz), 0.0);
+    }
+    default:
+    {
+        //Profile is the triangle (0,0), (R,0), (0,H); the axis is not a surface
+        double h = o.size[0];
+        double r = o.size[1];
+        double rho = std::sqrt(p[0]*p[0] + p[1]*p[1]);
+        double base = segment_distance(rho, p[2], 0, 0, r, 0);
+        double slant = segment_distance(rho, p[2], r, 0, 0, h);
+        bool inside = p[2] >= 0 && rho/r + p[2]/h <= 1;
+        double d = std::min(base, slant);
+        return inside ? -d : d;
+    }
+    }
+}
+
+}
+
+void chain_spheres(const JointStore &joints, FrameCache &frames, std::vector<CollisionSphere> &out)
+{
+    TRACE_SCOPE("chain_spheres");
+    const Chain &chain = joints.chain();
+    out.clear();
+    Frame local;
+    for (std::size_t i = 0; i < joints.size(); i++)
+    {
+        const Frame &b = frames.base_frame(chain, i);
+        double h = chain.height[i];
+        double rad = joints.radius()[i];
+        int count = sphere_count(h, rad);
+        for (int c = 0; c < count; c++)
+        {
+            segment_transform(chain, i, sphere_arc_length(h, count, c), local);
+            CollisionSphere s;
+            for (int j = 0; j < 3; j++)
+                s.center[j] = local.t[0]*b.r[0][j] + local.t[1]*b.r[1][j] + local.t[2]*b.r[2][j] + b.t[j];
+            s.radius = SPHERE_RADIUS_SCALE*rad;
+            s.joint = i;
+            out.push_back(s);
+        }
+    }
+}
+
+Frame shape_pose(const double translation[3], const double rotation[3])
+{
+    Frame rot[3];
+    for (int a = 0; a < 3; a++)
+    {
+        double c = std::cos(rotation[a]*DEG_TO_RAD);
+        double s = std::sin(rotation[a]*DEG_TO_RAD);
+        int i = (a+1)%3;
+        int j = (a+2)%3;
+        //Same layout as osg::Matrix::rotate about a coordinate axis
+        rot[a] = identity_frame();
+        rot[a].r[i][i] = c;
+        rot[a].r[i][j] = s;
+        rot[a].r[j][i] = -s;
+        rot[a].r[j][j] = c;
+    }
+    Frame pose = compose(compose(rot[0], rot[1]), rot[2]);
+    for (int k = 0; k < 3; k++)
+        pose.t[k] = translation[k];
+    return pose;
+}
+
+CollisionWorld::CollisionWorld():
+    mNextId{0},
+    mDirty{false}
+{}
+
+int CollisionWorld::add(const Obstacle &obstacle)
+{
+    mObstacles.push_back(obstacle);
+    mIds.push_back(mNextId);
+    mDirty = true;
+    return mNextId++;
+}
+
+bool CollisionWorld::remove(int id)
+{
+    std::vector<int>::iterator it = std::find(mIds.begin(), mIds.end(), id);
+    if (it == mIds.end())
+        return false;
+    std::size_t k = it - mIds.begin();
+    mObstacles.erase(mObstacles.begin()+k);
+    mIds.erase(it);
+    mDirty = true;
+    return true;
+}
+
+void CollisionWorld::clear()
+{
+    mObstacles.clear();
+    mIds.clear();
+    mDirty = true;
+}
+
+std::size_t CollisionWorld::size() const
+{
+    return mObstacles.size();
+}
+
+const CollisionStats &CollisionWorld::stats() const
+{
+    return mStats;
+}
+
+void CollisionWorld::build()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::size_t n = mObstacles.size();
+
+    //World box of every obstacle: lo[3], hi[3]
+    mBounds.resize(6*n);
+    for (std::size_t k = 0; k < n; k++)
+    {
+        const Obstacle &o = mObstacles[k];
+        double lo[3], hi[3];
+        local_bounds(o, lo, hi);
+        for (int j = 0; j < 3; j++)
+        {
+            double center = o.pose.t[j];
+            double extent = 0;
+            for (int i = 0; i < 3; i++)
+            {
+                center += 0.5*(lo[i] + hi[i])*o.pose.r[i][j];
+                extent += 0.5*(hi[i] - lo[i])*std::abs(o.pose.r[i][j]);
+            }
+            mBounds[6*k+j] = center - extent;
+            mBounds[6*k+3+j] = center + extent;
+        }
+    }
+
+    mOrder.resize(n);
+    for (std::size_t k = 0; k < n; k++)
+        mOrder[k] = k;
+    mNodes.clear();
+    if (n > 0)
+        build_node(0, n);
+    mDirty = false;
+    mStats.build_ms = elapsed_ms(start);
+}
+
+std::size_t CollisionWorld::build_node(std::size_t first, std::size_t count)
+{
+    std::size_t index = mNodes.size();
+    mNodes.push_back(Node());
+
+    Node node;
+    double cmin[3], cmax[3];
+    for (int j = 0; j < 3; j++)
+    {
+        node.min[j] = cmin[j] = 1e300;
+        node.max[j] = cmax[j] = -1e300;
+    }
+    for (std::size_t k = first; k < first+count; k++)
+    {
+        const double *b = &mBounds[6*mOrder[k]];
+        for (int j = 0; j < 3; j++)
+        {
+            node.min[j] = std::min(node.min[j], b[j]);
+            node.max[j] = std::max(node.max[j], b[3+j]);
+            double c = b[j] + b[3+j];
+            cmin[j] = std::min(cmin[j], c);
+            cmax[j] = std::max(cmax[j], c);
+        }
+    }
+
+    if (count <= LEAF_SIZE)
+    {
+        node.first = first;
+        node.count = count;
+        mNodes[index] = node;
+        return index;
+    }
+
+    //Median split along the longest axis of the centers
+    int axis = 0;
+    for (int j = 1; j < 3; j++)
+        if (cmax[j] - cmin[j] > cmax[axis] - cmin[axis])
+            axis = j;
+    std::size_t half = count/2;
+    const std::vector<double> &bounds = mBounds;
+    std::nth_element(mOrder.begin()+first, mOrder.begin()+first+half, mOrder.begin()+first+count,
+                     [&bounds, axis](std::size_t a, std::size_t b)
+    {
+        return bounds[6*a+axis] + bounds[6*a+3+axis] < bounds[6*b+axis] + bounds[6*b+3+axis];
+    });
+
+    build_node(first, half);
+    node.first = build_node(first+half, count-half);
+    node.count = 0;
+    mNodes[index] = node;
+    return index;
+}
+
+bool CollisionWorld::query(const std::vector<CollisionSphere> &spheres, std::vector<Contact> &contacts)
+{
+    TRACE_SCOPE("obstacle_query");
+    if (mDirty)
+        build();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    contacts.clear();
+    mStats.nodes_visited = 0;
+    mStats.narrow_tests = 0;
+    mStats.max_depth = 0;
+
+    for (std::size_t s = 0; s < spheres.size() && !mNodes.empty(); s++)
+    {
+        const CollisionSphere &sphere = spheres[s];
+        const double *c = sphere.center;
+        double r2 = sphere.radius*sphere.radius;
+
+        mStack.clear();
+        mStack.push_back(0);
+        while (!mStack.empty())
+        {
+            const Node &node = mNodes[mStack.back()];
+            std::size_t index = mStack.back();
+            mStack.pop_back();
+            mStats.nodes_visited++;
+
+            double d2 = 0;
+            for (int j = 0; j < 3; j++)
+            {
+                double d = std::max(node.min[j] - c[j], std::max(0.0, c[j] - node.max[j]));
+                d2 += d*d;
+            }
+            if (d2 > r2)
+                continue;
+
+            if (node.count == 0)
+            {
+                mStack.push_back(node.first);
+                mStack.push_back(index+1);
+                continue;
+            }
+
+            for (std::size_t k = node.first; k < node.first+node.count; k++)
+            {
+                const Obstacle &o = mObstacles[mOrder[k]];
+                mStats.narrow_tests++;
+
+                //Into the obstacle's local frame: p = (c - t)*R^T
+                double p[3];
+                for (int i = 0; i < 3; i++)
+                {
+                    p[i] = 0;
+                    for (int j = 0; j < 3; j++)
+                        p[i] += (c[j] - o.pose.t[j])*o.pose.r[i][j];
+                }
+                double depth = sphere.radius - signed_distance(o, p);
+                if (depth > 0)
+                {
+                    Contact contact;
+                    contact.sphere = s;
+                    contact.obstacle = mIds[mOrder[k]];
+                    contact.depth = depth;
+                    contacts.push_back(contact);
+                    mStats.max_depth = std::max(mStats.max_depth, depth);
+                }
+            }
+        }
+    }
+
+    mStats.contacts = contacts.size();
+    mStats.query_ms = elapsed_ms(start);
+    return !contacts.empty();
+}
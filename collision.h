@@ -0,0 +1,109 @@
+//-------------------------------------------------------
+// Filename: collision.h
+//
+// Description: Collision checking of the chain's spheres
+//              against static obstacles, using a bounding
+//              volume hierarchy over the obstacles.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <cstddef>
+#include <vector>
+#include "jointstore.h"
+
+struct CollisionSphere
+{
+    double center[3];
+    double radius;
+    std::size_t joint;
+};
+
+//World spheres of every joint, in chain order, as drawn by the viewer
+void chain_spheres(const JointStore &joints, FrameCache &frames, std::vector<CollisionSphere> &out);
+
+//Obstacle shapes, sized the way OSGWidget::create_shape builds them:
+//box size = (x, y, z) resting on z = 0, cone and cylinder size = (height, radius)
+//with the base on z = 0, sphere size = (radius) resting on z = 0.
+enum ObstacleShape
+{
+    SHAPE_BOX,
+    SHAPE_SPHERE,
+    SHAPE_CYLINDER,
+    SHAPE_CONE
+};
+
+struct Obstacle
+{
+    ObstacleShape shape;
+    double size[3];
+    Frame pose;
+};
+
+//Pose built like the viewer's shapes: rotate about x, then y, then z (degrees), then translate
+Frame shape_pose(const double translation[3], const double rotation[3]);
+
+struct Contact
+{
+    std::size_t sphere;
+    int obstacle;
+    //How far the sphere reaches into the obstacle
+    double depth;
+};
+
+struct CollisionStats
+{
+    double build_ms{0};
+    double query_ms{0};
+    std::size_t nodes_visited{0};
+    std::size_t narrow_tests{0};
+    std::size_t contacts{0};
+    double max_depth{0};
+};
+
+class CollisionWorld
+{
+public:
+    CollisionWorld();
+    int add(const Obstacle &obstacle);
+    bool remove(int id);
+    void clear();
+    std::size_t size() const;
+
+    //Rebuilds the hierarchy; query() does this itself after add or remove
+    void build();
+    //Returns true if any sphere touches an obstacle
+    bool query(const std::vector<CollisionSphere> &spheres, std::vector<Contact> &contacts);
+    const CollisionStats &stats() const;
+
+protected:
+    struct Node
+    {
+        double min[3];
+        double max[3];
+        //Leaves hold [first, first+count) of mOrder, inner nodes have count 0
+        //and their children at this+1 and first
+        std::size_t first;
+        std::size_t count;
+    };
+
+    std::vector<Obstacle> mObstacles;
+    std::vector<int> mIds;
+    int mNextId;
+    bool mDirty;
+
+    std::vector<Node> mNodes;
+    std::vector<std::size_t> mOrder;
+    std::vector<double> mBounds;
+    std::vector<std::size_t> mStack;
+    CollisionStats mStats;
+
+private:
+    std::size_t build_node(std::size_t first, std::size_t count);
+};
+
+#endif // COLLISION_H
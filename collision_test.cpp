@@ -0,0 +1,363 @@
+//-------------------------------------------------------
+// Filename: collision_test.cpp
+//
+// Description: Checks obstacle collision: depths of every
+//              shape at known points, the hierarchy against
+//              a loop over every obstacle, removal, and
+//              shape_pose against the viewer's osg rotations.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "collision.h"
+#include "testing.h"
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+Obstacle make_obstacle(ObstacleShape shape, double a, double b, double c)
+{
+    const double zero[3] = {0, 0, 0};
+    Obstacle o;
+    o.shape = shape;
+    o.size[0] = a;
+    o.size[1] = b;
+    o.size[2] = c;
+    o.pose = shape_pose(zero, zero);
+    return o;
+}
+
+//Depth of a sphere of radius 1 at (x, y, z) in a world holding only o, 0 if
+//there is no contact
+double depth_at(const Obstacle &o, double x, double y, double z)
+{
+    CollisionWorld world;
+    world.add(o);
+    std::vector<CollisionSphere> spheres(1);
+    spheres[0].center[0] = x;
+    spheres[0].center[1] = y;
+    spheres[0].center[2] = z;
+    spheres[0].radius = 1;
+    spheres[0].joint = 0;
+    std::vector<Contact> contacts;
+    world.query(spheres, contacts);
+    return contacts.empty() ? 0 : contacts[0].depth;
+}
+
+//Heights follow OSGWidget::create_shape: the box is centered at z/2, the
+//cylinder at h/2, the sphere at r and the cone at h/4, which puts every base
+//on z = 0 and the cone apex at z = h
+void test_known_points()
+{
+    const double tol = 1e-12;
+
+    //Box 4 x 2 x 6
+    Obstacle box = make_obstacle(SHAPE_BOX, 4, 2, 6);
+    CHECK_NEAR(depth_at(box, 0, 0, 3), 2, tol);
+    CHECK_NEAR(depth_at(box, 2, 0, 3), 1, tol);
+    CHECK_NEAR(depth_at(box, 0, 0, 6), 1, tol);
+    CHECK_NEAR(depth_at(box, 0, 0, -.5), .5, tol);
+    CHECK_NEAR(depth_at(box, 2.3, 1.4, 6), .5, tol);
+    CHECK(depth_at(box, 0, 2.5, 3) == 0);
+    CHECK(depth_at(box, 0, 0, 7.5) == 0);
+
+    //Sphere of radius 2
+    Obstacle sphere = make_obstacle(SHAPE_SPHERE, 2, 0, 0);
+    CHECK_NEAR(depth_at(sphere, 0, 0, 2), 3, tol);
+    CHECK_NEAR(depth_at(sphere, 2, 0, 2), 1, tol);
+    CHECK_NEAR(depth_at(sphere, 0, 0, 4.5), .5, tol);
+    CHECK_NEAR(depth_at(sphere, 0, 0, -.25), .75, tol);
+    CHECK(depth_at(sphere, 3, 3, 2) == 0);
+
+    //Cylinder of height 4, radius 1
+    Obstacle cylinder = make_obstacle(SHAPE_CYLINDER, 4, 1, 0);
+    CHECK_NEAR(depth_at(cylinder, 0, 0, 2), 2, tol);
+    CHECK_NEAR(depth_at(cylinder, 0, 0, .5), 1.5, tol);
+    CHECK_NEAR(depth_at(cylinder, 0, 1, 2), 1, tol);
+    CHECK_NEAR(depth_at(cylinder, 1, 0, 4), 1, tol);
+    CHECK_NEAR(depth_at(cylinder, 1.3, 0, 4.4), .5, tol);
+    CHECK_NEAR(depth_at(cylinder, 0, -1.3, -.4), .5, tol);
+    CHECK_NEAR(depth_at(cylinder, 0, 0, 4.25), .75, tol);
+    CHECK(depth_at(cylinder, 1.8, 0, 4.8) == 0);
+
+    //Cone of height 4, radius 2: the slant is the line 2 rho + z = 4
+    Obstacle cone = make_obstacle(SHAPE_CONE, 4, 2, 0);
+    double slant = std::sqrt(5.0);
+    CHECK_NEAR(depth_at(cone, 0, 0, 4), 1, tol);
+    CHECK_NEAR(depth_at(cone, 0, 0, 4.5), .5, tol);
+    CHECK_NEAR(depth_at(cone, 0, 0, 3.5), 1 + .5/slant, tol);
+    CHECK_NEAR(depth_at(cone, .1, 0, 4.1), 1 - std::sqrt(.02), tol);
+    CHECK_NEAR(depth_at(cone, 0, 0, 0), 1, tol);
+    CHECK_NEAR(depth_at(cone, 0, 0, 1), 2, tol);
+    CHECK_NEAR(depth_at(cone, 2, 0, 2), 1 - 2/slant, tol);
+    CHECK_NEAR(depth_at(cone, 0, 2.5, 0), .5, tol);
+    CHECK(depth_at(cone, 0, 0, 5.5) == 0);
+}
+
+//Signed distance worked out separately from collision.cpp: clamp to the
+//solid for outside points, nearest face for inside ones
+double reference_distance(const Obstacle &o, const double p[3])
+{
+    double rho = std::sqrt(p[0]*p[0] + p[1]*p[1]);
+    switch (o.shape)
+    {
+    case SHAPE_BOX:
+    {
+        double lo[3] = {-o.size[0]/2, -o.size[1]/2, 0};
+        double hi[3] = {o.size[0]/2, o.size[1]/2, o.size[2]};
+        double out = 0;
+        double in = 1e300;
+        for (int k = 0; k < 3; k++)
+        {
+            double d = p[k] - std::max(lo[k], std::min(hi[k], p[k]));
+            out += d*d;
+            in = std::min(in, std::min(p[k] - lo[k], hi[k] - p[k]));
+        }
+        return out > 0 ? std::sqrt(out) : -in;
+    }
+    case SHAPE_SPHERE:
+        return std::sqrt(rho*rho + (p[2] - o.size[0])*(p[2] - o.size[0])) - o.size[0];
+    case SHAPE_CYLINDER:
+    {
+        double h = o.size[0];
+        double r = o.size[1];
+        double dr = rho - std::min(rho, r);
+        double dz = p[2] - std::max(0.0, std::min(h, p[2]));
+        if (dr > 0 || dz != 0)
+            return std::sqrt(dr*dr + dz*dz);
+        return -std::min(r - rho, std::min(p[2], h - p[2]));
+    }
+    default:
+    {
+        double h = o.size[0];
+        double r = o.size[1];
+        double norm = std::sqrt(1/(r*r) + 1/(h*h));
+        double slant = (1 - rho/r - p[2]/h)/norm;
+        if (p[2] >= 0 && slant >= 0)
+            return -std::min(p[2], slant);
+        //Outside, the nearest point is on the base or on the slant edge
+        double base_r = std::min(rho, r);
+        double base = std::sqrt((rho - base_r)*(rho - base_r) + p[2]*p[2]);
+        double t = std::max(0.0, std::min(1.0, ((rho - r)*-r + p[2]*h)/(r*r + h*h)));
+        double er = rho - (r - t*r);
+        double ez = p[2] - t*h;
+        return std::min(base, std::sqrt(er*er + ez*ez));
+    }
+    }
+}
+
+double reference_depth(const Obstacle &o, const CollisionSphere &s)
+{
+    double p[3];
+    for (int i = 0; i < 3; i++)
+        p[i] = (s.center[0] - o.pose.t[0])*o.pose.r[i][0] + (s.center[1] - o.pose.t[1])*o.pose.r[i][1] +
+                (s.center[2] - o.pose.t[2])*o.pose.r[i][2];
+    return s.radius - reference_distance(o, p);
+}
+
+bool contact_less(const Contact &a, const Contact &b)
+{
+    return a.sphere < b.sphere || (a.sphere == b.sphere && a.obstacle < b.obstacle);
+}
+
+//Every contact the hierarchy reports has the reference depth, and every pair
+//the reference finds clearly touching is reported once
+void check_against_loop(CollisionWorld &world, const std::vector<Obstacle> &obstacles, const std::vector<int> &ids,
+                        const std::vector<CollisionSphere> &spheres)
+{
+    std::vector<Contact> contacts;
+    world.query(spheres, contacts);
+    std::sort(contacts.begin(), contacts.end(), contact_less);
+
+    std::vector<Contact> expected;
+    for (std::size_t s = 0; s < spheres.size(); s++)
+    {
+        for (std::size_t k = 0; k < obstacles.size(); k++)
+        {
+            if (ids[k] < 0)
+                continue;
+            Contact c;
+            c.sphere = s;
+            c.obstacle = ids[k];
+            c.depth = reference_depth(obstacles[k], spheres[s]);
+            if (c.depth > 1e-9)
+                expected.push_back(c);
+        }
+    }
+    std::sort(expected.begin(), expected.end(), contact_less);
+
+    std::size_t e = 0;
+    int missing = 0;
+    for (const Contact &c : contacts)
+    {
+        int k = int(std::find(ids.begin(), ids.end(), c.obstacle) - ids.begin());
+        if (!CHECK(k < int(ids.size())))
+            continue;
+        CHECK_NEAR(c.depth, reference_depth(obstacles[k], spheres[c.sphere]), 1e-9);
+        while (e < expected.size() && contact_less(expected[e], c))
+        {
+            missing++;
+            e++;
+        }
+        if (e < expected.size() && !contact_less(c, expected[e]))
+            e++;
+    }
+    missing += int(expected.size() - e);
+    if (!CHECK(missing == 0))
+        std::printf("  %d of %d contacts missing\n", missing, int(expected.size()));
+    CHECK(contacts.size() >= expected.size());
+    CHECK(std::adjacent_find(contacts.begin(), contacts.end(), [](const Contact &a, const Contact &b)
+    {
+        return !contact_less(a, b);
+    }) == contacts.end());
+}
+
+void test_against_loop()
+{
+    std::mt19937 random(9);
+    std::uniform_real_distribution<double> place(-40, 40);
+    std::uniform_real_distribution<double> angle(-180, 180);
+    std::uniform_real_distribution<double> size(.2, 6);
+    std::uniform_real_distribution<double> radius(.05, 3);
+
+    CollisionWorld world;
+    std::vector<Obstacle> obstacles;
+    std::vector<int> ids;
+    for (int k = 0; k < 3000; k++)
+    {
+        double t[3] = {place(random), place(random), place(random)};
+        double rot[3] = {angle(random), angle(random), angle(random)};
+        Obstacle o = make_obstacle(ObstacleShape(random() % 4), size(random), size(random), size(random));
+        o.pose = shape_pose(t, rot);
+        obstacles.push_back(o);
+        ids.push_back(world.add(o));
+    }
+    CHECK(world.size() == obstacles.size());
+
+    std::vector<CollisionSphere> spheres(3000);
+    for (std::size_t s = 0; s < spheres.size(); s++)
+    {
+        for (int j = 0; j < 3; j++)
+            spheres[s].center[j] = place(random);
+        spheres[s].radius = radius(random);
+        spheres[s].joint = s;
+    }
+    check_against_loop(world, obstacles, ids, spheres);
+
+    //Removed obstacles stop being reported, everything else stays the same
+    std::vector<Contact> contacts;
+    world.query(spheres, contacts);
+    std::vector<int> removed;
+    for (const Contact &c : contacts)
+    {
+        if (removed.size() < 50 && std::find(removed.begin(), removed.end(), c.obstacle) == removed.end())
+            removed.push_back(c.obstacle);
+    }
+    CHECK(removed.size() == 50);
+    for (int id : removed)
+    {
+        CHECK(world.remove(id));
+        CHECK(!world.remove(id));
+        ids[std::find(ids.begin(), ids.end(), id) - ids.begin()] = -1;
+    }
+    CHECK(world.size() == obstacles.size() - removed.size());
+    world.query(spheres, contacts);
+    for (const Contact &c : contacts)
+        CHECK(std::find(removed.begin(), removed.end(), c.obstacle) == removed.end());
+    check_against_loop(world, obstacles, ids, spheres);
+
+    //Ids are not reused after a remove
+    int next = world.add(obstacles[0]);
+    CHECK(std::find(removed.begin(), removed.end(), next) == removed.end());
+    CHECK(next == int(obstacles.size()));
+}
+
+//Row vector form of osg::Matrix::rotate(angle, axis): row i is e_i rotated
+void osg_rotate(double radians, const double axis[3], double m[3][3])
+{
+    double c = std::cos(radians);
+    double s = std::sin(radians);
+    for (int i = 0; i < 3; i++)
+    {
+        double e[3] = {0, 0, 0};
+        e[i] = 1;
+        double cross[3] = {axis[1]*e[2] - axis[2]*e[1], axis[2]*e[0] - axis[0]*e[2], axis[0]*e[1] - axis[1]*e[0]};
+        for (int j = 0; j < 3; j++)
+            m[i][j] = c*e[j] + s*cross[j] + (1 - c)*axis[i]*axis[j];
+    }
+}
+
+void multiply(const double a[3][3], const double b[3][3], double out[3][3])
+{
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            out[i][j] = a[i][0]*b[0][j] + a[i][1]*b[1][j] + a[i][2]*b[2][j];
+}
+
+//OSGWidget::shape_setup builds mrx*mry*mrz*mt, which shape_pose has to match
+void test_shape_pose()
+{
+    const double axes[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    std::mt19937 random(3);
+    std::uniform_real_distribution<double> angle(-360, 360);
+    std::uniform_real_distribution<double> place(-10, 10);
+    for (int k = 0; k < 200; k++)
+    {
+        double t[3] = {place(random), place(random), place(random)};
+        double rot[3] = {angle(random), angle(random), angle(random)};
+        if (k < 3)
+        {
+            rot[0] = rot[1] = rot[2] = 0;
+            rot[k] = 90;
+        }
+
+        double m[3][3][3];
+        for (int a = 0; a < 3; a++)
+            osg_rotate(rot[a]*PI/180, axes[a], m[a]);
+        double xy[3][3], xyz[3][3];
+        multiply(m[0], m[1], xy);
+        multiply(xy, m[2], xyz);
+
+        Frame pose = shape_pose(t, rot);
+        double error = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+                error = std::max(error, std::fabs(pose.r[i][j] - xyz[i][j]));
+            error = std::max(error, std::fabs(pose.t[i] - t[i]));
+        }
+        if (!CHECK(error < 1e-12))
+            std::printf("  rotation (%g, %g, %g): error %g\n", rot[0], rot[1], rot[2], error);
+    }
+
+    //90 degrees about z takes x to y, as osg does
+    const double zero[3] = {0, 0, 0};
+    const double about_z[3] = {0, 0, 90};
+    Frame pose = shape_pose(zero, about_z);
+    CHECK_NEAR(pose.r[0][1], 1, 1e-15);
+    CHECK_NEAR(pose.r[1][0], -1, 1e-15);
+
+    //90 degrees about x takes z to -y, so a tall box lies down along -y
+    Obstacle box = make_obstacle(SHAPE_BOX, 2, 2, 10);
+    const double about_x[3] = {90, 0, 0};
+    box.pose = shape_pose(zero, about_x);
+    CHECK(depth_at(box, 0, -9, 0) > 0);
+    CHECK(depth_at(box, 0, 9, 0) == 0);
+}
+
+}
+
+int main()
+{
+    test_known_points();
+    test_against_loop();
+    test_shape_pose();
+    return test_result();
+}
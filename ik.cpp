@@ -0,0 +1,304 @@
+//-------------------------------------------------------
+// Filename: ik.cpp
+//
+// Description: Damped least squares inverse kinematics for
+//              the soft robot chain.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "ik.h"
+#include "jacobian.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+//Scratch space for one thread, reused for every target it solves
+struct IkWorkspace
+{
+    Chain chain;
+    ChainJacobian jacobian;
+    std::vector<double> j;
+    std::vector<double> step;
+    std::vector<double> u;
+    std::vector<double> v;
+};
+
+//Rotation vector taking the current orientation to the target, in world coordinates
+void orientation_error(const Frame &target, const Frame &current, double out[3])
+{
+    //E = Rt*Rc^T, and osg style frames store R transposed
+    double e[3][3];
+    for (int a = 0; a < 3; a++)
+        for (int b = 0; b < 3; b++)
+            e[a][b] = target.r[0][a]*current.r[0][b] + target.r[1][a]*current.r[1][b] + target.r[2][a]*current.r[2][b];
+
+    double w[3] = {0.5*(e[2][1] - e[1][2]), 0.5*(e[0][2] - e[2][0]), 0.5*(e[1][0] - e[0][1])};
+    double c = std::max(-1.0, std::min(1.0, 0.5*(e[0][0] + e[1][1] + e[2][2] - 1)));
+    double angle = std::acos(c);
+    double s = std::sqrt(w[0]*w[0] + w[1]*w[1] + w[2]*w[2]);
+
+    if (s > 1e-6)
+    {
+        for (int k = 0; k < 3; k++)
+            out[k] = w[k]*angle/s;
+    }
+    else if (c > 0)
+    {
+        //Small angle, sin(angle) ~ angle
+        for (int k = 0; k < 3; k++)
+            out[k] = w[k];
+    }
+    else
+    {
+        //Half turn: the axis is the largest column of (E + I)/2
+        int k = 0;
+        for (int a = 1; a < 3; a++)
+            if (e[a][a] > e[k][k])
+                k = a;
+        double axis[3] = {0.5*(e[0][k] + (k == 0)), 0.5*(e[1][k] + (k == 1)), 0.5*(e[2][k] + (k == 2))};
+        double len = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+        for (int a = 0; a < 3; a++)
+            out[a] = axis[a]*angle/len;
+    }
+}
+
+//Weighted error, its squared norm and the unweighted position/orientation norms
+double task_error(const IkTarget &target, const Frame &current, const IkOptions &options,
+                  double err[6], double &position, double &orientation)
+{
+    for (int k = 0; k < 3; k++)
+        err[k] = target.pose.t[k] - current.t[k];
+    position = std::sqrt(err[0]*err[0] + err[1]*err[1] + err[2]*err[2]);
+    double cost = position*position;
+    orientation = 0;
+
+    if (target.use_orientation)
+    {
+        orientation_error(target.pose, current, err+3);
+        orientation = std::sqrt(err[3]*err[3] + err[4]*err[4] + err[5]*err[5]);
+        for (int k = 3; k < 6; k++)
+            err[k] *= options.orientation_weight;
+        cost += options.orientation_weight*options.orientation_weight*orientation*orientation;
+    }
+    return cost;
+}
+
+//Solves the m x m system a*x = b in place with a Cholesky factorisation
+bool cholesky_solve(double a[6][6], double b[6], int m)
+{
+    for (int i = 0; i < m; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            double sum = a[i][j];
+            for (int k = 0; k < j; k++)
+                sum -= a[i][k]*a[j][k];
+            if (i == j)
+            {
+                if (sum <= 0)
+                    return false;
+                a[i][i] = std::sqrt(sum);
+            }
+            else
+                a[i][j] = sum/a[j][j];
+        }
+    }
+    for (int i = 0; i < m; i++)
+    {
+        for (int k = 0; k < i; k++)
+            b[i] -= a[i][k]*b[k];
+        b[i] /= a[i][i];
+    }
+    for (int i = m-1; i >= 0; i--)
+    {
+        for (int k = i+1; k < m; k++)
+            b[i] -= a[k][i]*b[k];
+        b[i] /= a[i][i];
+    }
+    return true;
+}
+
+bool solve_one(const Chain &seed, const IkOptions &options, const IkTarget &target,
+               IkWorkspace &ws, IkResult &result)
+{
+    std::size_t n = seed.size();
+    std::size_t cols = 2*n;
+    int m = target.use_orientation ? 6 : 3;
+
+    ws.chain = seed;
+    result.converged = false;
+    result.iterations = 0;
+
+    double err[6];
+    double position, orientation;
+    ws.jacobian.compute(ws.chain);
+    double cost = task_error(target, ws.jacobian.frames()[n], options, err, position, orientation);
+    double lambda = options.damping;
+
+    for (int it = 0; it < options.max_iterations; it++)
+    {
+        if (position < options.tolerance && (!target.use_orientation || orientation < options.tolerance))
+        {
+            result.converged = true;
+            break;
+        }
+        result.iterations = it+1;
+
+        ws.jacobian.end_effector(ws.j);
+        if (target.use_orientation)
+        {
+            for (std::size_t k = 3*cols; k < 6*cols; k++)
+                ws.j[k] *= options.orientation_weight;
+        }
+
+        //(J*J^T + lambda^2*I) y = e, then dq = J^T y
+        double a[6][6];
+        double y[6];
+        for (int r = 0; r < m; r++)
+        {
+            for (int c = 0; c <= r; c++)
+            {
+                double sum = 0;
+                const double *jr = &ws.j[r*cols];
+                const double *jc = &ws.j[c*cols];
+                for (std::size_t k = 0; k < cols; k++)
+                    sum += jr[k]*jc[k];
+                a[r][c] = sum;
+                a[c][r] = sum;
+            }
+            a[r][r] += lambda*lambda;
+            y[r] = err[r];
+        }
+        if (!cholesky_solve(a, y, m))
+        {
+            lambda *= 10;
+            continue;
+        }
+
+        ws.step.assign(cols, 0.0);
+        double largest = 0;
+        for (std::size_t k = 0; k < cols; k++)
+        {
+            double sum = 0;
+            for (int r = 0; r < m; r++)
+                sum += ws.j[r*cols+k]*y[r];
+            ws.step[k] = sum;
+        }
+        for (std::size_t i = 0; i < n; i++)
+            largest = std::max(largest, std::sqrt(ws.step[2*i]*ws.step[2*i] + ws.step[2*i+1]*ws.step[2*i+1]));
+        double scale = largest > options.max_step ? options.max_step/largest : 1.0;
+
+        //Try the step with the joint limits applied, and keep it only if it helps
+        ws.u = ws.chain.u;
+        ws.v = ws.chain.v;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            ws.chain.u[i] = std::max(-options.limit, std::min(options.limit, ws.chain.u[i] + scale*ws.step[2*i]));
+            ws.chain.v[i] = std::max(-options.limit, std::min(options.limit, ws.chain.v[i] + scale*ws.step[2*i+1]));
+        }
+        ws.jacobian.compute(ws.chain);
+        double new_err[6];
+        double new_position, new_orientation;
+        double new_cost = task_error(target, ws.jacobian.frames()[n], options, new_err, new_position, new_orientation);
+
+        if (new_cost < cost)
+        {
+            cost = new_cost;
+            position = new_position;
+            orientation = new_orientation;
+            std::copy(new_err, new_err+6, err);
+            lambda = std::max(options.damping, 0.5*lambda);
+        }
+        else
+        {
+            ws.chain.u.swap(ws.u);
+            ws.chain.v.swap(ws.v);
+            ws.jacobian.compute(ws.chain);
+            lambda *= 4;
+        }
+    }
+    if (position < options.tolerance && (!target.use_orientation || orientation < options.tolerance))
+        result.converged = true;
+
+    result.u = ws.chain.u;
+    result.v = ws.chain.v;
+    result.position_error = position;
+    result.orientation_error = orientation;
+    return result.converged;
+}
+
+}
+
+IkSolver::IkSolver(const Chain &chain, const IkOptions &options):
+    mChain{chain},
+    mOptions{options}
+{}
+
+bool IkSolver::solve(const IkTarget &target, IkResult &result) const
+{
+    IkWorkspace ws;
+    return solve_one(mChain, mOptions, target, ws, result);
+}
+
+IkStats IkSolver::solve_batch(const std::vector<IkTarget> &targets, std::vector<IkResult> &results) const
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    results.resize(targets.size());
+
+    unsigned threads = mOptions.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > targets.size())
+        threads = std::max<std::size_t>(1, targets.size());
+
+    //Threads grab small blocks of targets so uneven solve times even out
+    const std::size_t block = 16;
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]()
+    {
+        IkWorkspace ws;
+        for (;;)
+        {
+            std::size_t first = next.fetch_add(block);
+            if (first >= targets.size())
+                break;
+            std::size_t last = std::min(targets.size(), first+block);
+            for (std::size_t k = first; k < last; k++)
+                solve_one(mChain, mOptions, targets[k], ws, results[k]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+        pool.push_back(std::thread(worker));
+    worker();
+    for (std::size_t t = 0; t < pool.size(); t++)
+        pool[t].join();
+
+    IkStats stats;
+    stats.targets = targets.size();
+    stats.threads = threads;
+    for (std::size_t k = 0; k < results.size(); k++)
+    {
+        const IkResult &r = results[k];
+        if (r.converged)
+            stats.converged++;
+        stats.mean_iterations += r.iterations;
+        stats.max_iterations = std::max(stats.max_iterations, r.iterations);
+        stats.mean_position_error += r.position_error;
+        stats.max_position_error = std::max(stats.max_position_error, r.position_error);
+    }
+    if (!results.empty())
+    {
+        stats.mean_iterations /= results.size();
+        stats.mean_position_error /= results.size();
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,76 @@
+//-------------------------------------------------------
+// Filename: ik.h
+//
+// Description: Damped least squares inverse kinematics for
+//              the soft robot chain, with a batch mode that
+//              spreads targets across all cores.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef IK_H
+#define IK_H
+
+#include <cstddef>
+#include <vector>
+#include "kinematics.h"
+
+//End effector goal. Only the origin of pose is used unless use_orientation is set.
+struct IkTarget
+{
+    Frame pose;
+    bool use_orientation{false};
+};
+
+struct IkOptions
+{
+    int max_iterations{100};
+    //Position error, and orientation error in radians, to stop at
+    double tolerance{1e-4};
+    double damping{1e-2};
+    double orientation_weight{1.0};
+    //Largest change of any (u, v) pair per iteration
+    double max_step{0.5};
+    //Every u and v is kept within [-limit, limit]
+    double limit{AXIS_LIMIT};
+    //0 uses every core
+    unsigned threads{0};
+};
+
+struct IkResult
+{
+    std::vector<double> u;
+    std::vector<double> v;
+    bool converged{false};
+    int iterations{0};
+    double position_error{0};
+    double orientation_error{0};
+};
+
+struct IkStats
+{
+    std::size_t targets{0};
+    std::size_t converged{0};
+    double mean_iterations{0};
+    int max_iterations{0};
+    double mean_position_error{0};
+    double max_position_error{0};
+    double seconds{0};
+    unsigned threads{0};
+};
+
+class IkSolver
+{
+public:
+    //Every solve starts from the configuration in chain
+    IkSolver(const Chain &chain, const IkOptions &options = IkOptions());
+    bool solve(const IkTarget &target, IkResult &result) const;
+    IkStats solve_batch(const std::vector<IkTarget> &targets, std::vector<IkResult> &results) const;
+
+protected:
+    Chain mChain;
+    IkOptions mOptions;
+};
+
+#endif // IK_H
@@ -0,0 +1,167 @@
+//-------------------------------------------------------
+// Filename: ik_test.cpp
+//
+// Description: Checks that the IK solver reaches poses the
+//              chain can reach, and reports failure for
+//              ones it cannot.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <cmath>
+#include <random>
+#include <vector>
+#include "ik.h"
+#include "testing.h"
+
+namespace {
+
+Chain make_chain()
+{
+    Chain chain;
+    for (int i = 0; i < 4; i++)
+        chain.push_back(0, 0, 5);
+    return chain;
+}
+
+//A random configuration within the limits
+Chain random_config(const Chain &chain, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> bend(-1.2, 1.2);
+    Chain posed = chain;
+    for (std::size_t i = 0; i < posed.size(); i++)
+    {
+        posed.u[i] = bend(rng);
+        posed.v[i] = bend(rng);
+    }
+    return posed;
+}
+
+Frame end_pose(const Chain &chain)
+{
+    std::vector<Frame> frames;
+    forward_kinematics(chain, frames);
+    return frames.back();
+}
+
+Frame random_pose(const Chain &chain, std::mt19937 &rng)
+{
+    return end_pose(random_config(chain, rng));
+}
+
+//The end effector of a solution is where the solver says it is
+double solution_error(const Chain &chain, const IkResult &result, const IkTarget &target)
+{
+    Chain solved = chain;
+    solved.u = result.u;
+    solved.v = result.v;
+    Frame pose = end_pose(solved);
+    const double *t = pose.t;
+    double dx = t[0] - target.pose.t[0];
+    double dy = t[1] - target.pose.t[1];
+    double dz = t[2] - target.pose.t[2];
+    return std::sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+void test_reachable()
+{
+    Chain chain = make_chain();
+    IkOptions options;
+    IkSolver solver(chain, options);
+    std::mt19937 rng(1);
+
+    for (int k = 0; k < 20; k++)
+    {
+        IkTarget target;
+        target.pose = random_pose(chain, rng);
+        IkResult result;
+        CHECK(solver.solve(target, result));
+        CHECK(result.converged);
+        CHECK(result.position_error < options.tolerance);
+        CHECK(solution_error(chain, result, target) < options.tolerance);
+        CHECK(result.u.size() == chain.size());
+        for (std::size_t i = 0; i < result.u.size(); i++)
+            CHECK(std::fabs(result.u[i]) <= options.limit && std::fabs(result.v[i]) <= options.limit);
+    }
+
+    //Full poses are solved locally: from a seed near the answer the solver
+    //converges, from far away it may stop in a local minimum
+    std::uniform_real_distribution<double> noise(-.2, .2);
+    for (int k = 0; k < 20; k++)
+    {
+        Chain posed = random_config(chain, rng);
+        IkTarget target;
+        target.pose = end_pose(posed);
+        target.use_orientation = true;
+
+        Chain seed = posed;
+        for (std::size_t i = 0; i < seed.size(); i++)
+        {
+            seed.u[i] += noise(rng);
+            seed.v[i] += noise(rng);
+        }
+        IkResult result;
+        CHECK(IkSolver(seed, options).solve(target, result));
+        CHECK(result.position_error < options.tolerance);
+        CHECK(result.orientation_error < options.tolerance);
+    }
+}
+
+void test_unreachable()
+{
+    Chain chain = make_chain();
+    IkOptions options;
+    IkSolver solver(chain, options);
+
+    //Far past the chain's length
+    IkTarget target;
+    target.pose = translate_frame(0, 0, 100);
+    IkResult result;
+    CHECK(!solver.solve(target, result));
+    CHECK(!result.converged);
+    CHECK(result.iterations == options.max_iterations);
+    CHECK(result.position_error > 50);
+}
+
+void test_batch()
+{
+    Chain chain = make_chain();
+    IkOptions options;
+    options.threads = 4;
+    IkSolver solver(chain, options);
+    std::mt19937 rng(2);
+
+    std::vector<IkTarget> targets(500);
+    for (std::size_t k = 0; k < targets.size(); k++)
+        targets[k].pose = random_pose(chain, rng);
+    targets[100].pose = translate_frame(100, 0, 0);
+
+    std::vector<IkResult> results;
+    IkStats stats = solver.solve_batch(targets, results);
+    CHECK(results.size() == targets.size());
+    CHECK(stats.targets == targets.size());
+    CHECK(!results[100].converged);
+    CHECK(stats.converged == targets.size()-1);
+    CHECK(stats.max_iterations == options.max_iterations);
+    CHECK(stats.max_position_error > 50);
+
+    //Batch results are the same as one at a time
+    for (std::size_t k = 0; k < targets.size(); k += 50)
+    {
+        IkResult one;
+        solver.solve(targets[k], one);
+        CHECK(one.converged == results[k].converged);
+        CHECK(one.u == results[k].u && one.v == results[k].v);
+    }
+}
+
+}
+
+int main()
+{
+    test_reachable();
+    test_unreachable();
+    test_batch();
+    return test_result();
+}
@@ -0,0 +1,145 @@
+//-------------------------------------------------------
+// Filename: jacobian.cpp
+//
+// Description: Analytic Jacobian of the soft robot chain.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "jacobian.h"
+#include <cmath>
+
+namespace {
+
+//Coefficients of a segment as functions of x = phi^2:
+//A = sin(phi)/phi, B = (1-cos(phi))/phi^2, C = (phi-sin(phi))/phi^3,
+//plus dA/dx and dB/dx. Taylor series near zero avoid the cancellation.
+struct ArcCoefficients
+{
+    double a, b, c, da, db;
+};
+
+ArcCoefficients arc_coefficients(double x)
+{
+    ArcCoefficients k;
+    if (x < 1e-2)
+    {
+        k.a = 1 - x/6*(1 - x/20*(1 - x/42*(1 - x/72)));
+        k.b = 0.5*(1 - x/12*(1 - x/30*(1 - x/56*(1 - x/90))));
+        k.c = (1 - x/20*(1 - x/42*(1 - x/72*(1 - x/110))))/6;
+        k.da = -1.0/6 + x/60 - x*x/1680 + x*x*x/90720 - x*x*x*x/7983360;
+        k.db = -1.0/24 + x/360 - x*x/13440 + x*x*x/907200 - x*x*x*x/95800320;
+        return k;
+    }
+    double phi = std::sqrt(x);
+    double sh = std::sin(0.5*phi);
+    k.a = std::sin(phi)/phi;
+    k.b = 2*sh*sh/x;
+    k.c = (1 - k.a)/x;
+    k.da = (std::cos(phi) - k.a)/(2*x);
+    k.db = (k.a - 2*k.b)/(2*x);
+    return k;
+}
+
+//Row vector times the rotation part of a frame
+void rotate(const double in[3], const Frame &f, double out[3])
+{
+    for (int j = 0; j < 3; j++)
+        out[j] = in[0]*f.r[0][j] + in[1]*f.r[1][j] + in[2]*f.r[2][j];
+}
+
+}
+
+ChainJacobian::ChainJacobian():
+    mCount{0}
+{}
+
+void ChainJacobian::compute(const Chain &chain)
+{
+    std::size_t n = chain.size();
+    mCount = n;
+    mFrames.resize(n+1);
+    mOmega.resize(6*n);
+    mLinear.resize(6*n);
+    mEnd.resize(3*n);
+    mFrames[0] = chain.base;
+
+    Frame seg;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        double u = chain.u[i];
+        double v = chain.v[i];
+        double h = chain.height[i];
+        ArcCoefficients k = arc_coefficients(u*u + v*v);
+
+        //Angular velocity of the segment end in the segment base frame:
+        //the columns of the left Jacobian of SO(3) for w = (u, v, 0)
+        double omega_u[3] = {1 - k.c*v*v, k.c*u*v, -k.b*v};
+        double omega_v[3] = {k.c*u*v, 1 - k.c*u*u, k.b*u};
+
+        //Derivatives of t = h*(B*v, -B*u, A), with dx/du = 2u and dx/dv = 2v
+        double dt_u[3] = {h*2*u*k.db*v, -h*(k.b + 2*u*k.db*u), h*2*u*k.da};
+        double dt_v[3] = {h*(k.b + 2*v*k.db*v), -h*2*v*k.db*u, h*2*v*k.da};
+
+        const Frame &base = mFrames[i];
+        rotate(omega_u, base, &mOmega[6*i]);
+        rotate(omega_v, base, &mOmega[6*i+3]);
+        rotate(dt_u, base, &mLinear[6*i]);
+        rotate(dt_v, base, &mLinear[6*i+3]);
+
+        arc_transform(u, v, h, seg);
+        compose(seg, base, mFrames[i+1]);
+        Frame &next = mFrames[i+1];
+        for (int j = 0; j < 3; j++)
+            mEnd[3*i+j] = next.t[j];
+        if (i+1 < n)
+        {
+            for (int j = 0; j < 3; j++)
+                next.t[j] += JOINT_GAP*next.r[2][j];
+        }
+    }
+}
+
+const std::vector<Frame> &ChainJacobian::frames() const
+{
+    return mFrames;
+}
+
+void ChainJacobian::end_effector(std::vector<double> &jacobian) const
+{
+    at_frame(mCount, jacobian);
+}
+
+void ChainJacobian::at_frame(std::size_t k, std::vector<double> &jacobian) const
+{
+    std::size_t cols = 2*mCount;
+    jacobian.assign(6*cols, 0.0);
+    const double *p = mFrames[k].t;
+
+    for (std::size_t i = 0; i < k && i < mCount; i++)
+    {
+        //Moving joint i swings everything past its end about the segment end
+        double d[3] = {p[0] - mEnd[3*i], p[1] - mEnd[3*i+1], p[2] - mEnd[3*i+2]};
+        for (int q = 0; q < 2; q++)
+        {
+            std::size_t col = 2*i+q;
+            const double *w = &mOmega[3*col];
+            const double *l = &mLinear[3*col];
+            jacobian[0*cols+col] = l[0] + w[1]*d[2] - w[2]*d[1];
+            jacobian[1*cols+col] = l[1] + w[2]*d[0] - w[0]*d[2];
+            jacobian[2*cols+col] = l[2] + w[0]*d[1] - w[1]*d[0];
+            jacobian[3*cols+col] = w[0];
+            jacobian[4*cols+col] = w[1];
+            jacobian[5*cols+col] = w[2];
+        }
+    }
+}
+
+void forward_kinematics_jacobian(const Chain &chain, std::vector<Frame> &out_frames, std::vector<double> &jacobian)
+{
+    ChainJacobian j;
+    j.compute(chain);
+    out_frames = j.frames();
+    j.end_effector(jacobian);
+}
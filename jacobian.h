@@ -0,0 +1,50 @@
+//-------------------------------------------------------
+// Filename: jacobian.h
+//
+// Description: Analytic Jacobian of the soft robot chain
+//              with respect to every joint's (u, v).
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef JACOBIAN_H
+#define JACOBIAN_H
+
+#include <cstddef>
+#include <vector>
+#include "kinematics.h"
+
+//Jacobians are 6 x 2N, stored row major. Rows 0-2 are the linear velocity
+//and rows 3-5 the angular velocity of a frame, both in world coordinates.
+//Column 2i is joint i's u and column 2i+1 its v.
+class ChainJacobian
+{
+public:
+    ChainJacobian();
+
+    //Forward kinematics and the per-joint derivatives in one pass
+    void compute(const Chain &chain);
+
+    //Same layout as forward_kinematics
+    const std::vector<Frame> &frames() const;
+
+    void end_effector(std::vector<double> &jacobian) const;
+    //Jacobian of frames()[k]; joints at or after k do not move it
+    void at_frame(std::size_t k, std::vector<double> &jacobian) const;
+
+protected:
+    std::size_t mCount;
+    std::vector<Frame> mFrames;
+    //Per column: angular velocity and the linear velocity of the segment
+    //end, both in world coordinates
+    std::vector<double> mOmega;
+    std::vector<double> mLinear;
+    //World origin of the end of each segment
+    std::vector<double> mEnd;
+};
+
+//Convenience wrapper: frames as forward_kinematics, plus the end effector Jacobian
+void forward_kinematics_jacobian(const Chain &chain, std::vector<Frame> &out_frames, std::vector<double> &jacobian);
+
+#endif // JACOBIAN_H
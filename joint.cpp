@@ -9,46 +9,43 @@
 //-------------------------------------------------------
 
 #include "joint.h"
-#include <math.h>
-
-Joint::Joint(int id, double height, double radius)
-{
-    mId = id;
-    mHeight = height;
-    mRadius = radius;
-    mSphereCount = height/radius;
-    if(mSphereCount <= 0)
-        mSphereCount = 1;
-    mU = 0;
-    mV = 0;
+
+Joint::Joint(JointStore *store, JointHandle handle)
+{
+    mStore = store;
+    mHandle = handle;
     mT = new osg::MatrixTransform;
-    for(int i = 0; i < mSphereCount; i++)
-    {
-        mTi.push_back(new osg::MatrixTransform);
-    }
     update_T();
 }
 
+JointHandle Joint::get_handle()
+{
+    return mHandle;
+}
+
+std::size_t Joint::index()
+{
+    return mStore->index(mHandle);
+}
+
 int Joint::get_id()
 {
-    return mId;
+    return mStore->get_id(index());
 }
 
 void Joint::set_id(int id)
 {
-    mId = id;
+    mStore->set_id(index(), id);
 }
 
 void Joint::get_axis(double &u, double &v)
 {
-    u = mU;
-    v = mV;
+    mStore->get_axis(index(), u, v);
 }
 
 void Joint::set_axis(double u, double v)
 {
-    mU = u;
-    mV = v;
+    mStore->set_axis(index(), u, v);
     update_T();
 }
 
@@ -56,84 +53,63 @@ osg::MatrixTransform* Joint::get_T()
 {
     return mT;
 }
-osg::MatrixTransform* Joint:: get_Ti(int index)
-{
-    if(index >= mSphereCount)
-        index = mSphereCount-1;
-    return mTi[index];
-}
 osg::Matrix Joint::get_trans(double height)
 {
-    double scale_factor = height/mHeight;
-    double u = mU*scale_factor;
-    double v = mV*scale_factor;
-    double w_mag = std::sqrt(u*u + v*v);
-    double phi = w_mag;
-    osg::Matrix trans;
-
-    if(std::abs(phi) < std::pow(10,-6))
-    {
-        trans= osg::Matrix::translate(0, 0, height);
-    }
-    else
-    {
-        double sp = std::sin(phi);
-        double cp = std::cos(phi);
-        double sig = cp-1;
-        double ub = u/phi;
-        double vb = v/phi;
-        double x = 1/(std::abs(u)+std::abs(v));
-
-        trans = osg::Matrix::rotate(phi,u*x,x*v,0)*osg::Matrix::translate(-sig*height*vb/phi,sig*height*ub/phi,height*sp/phi);
-    }
-    return trans;
+    Frame trans;
+    segment_transform(mStore->chain(), index(), height, trans);
+    return to_matrix(trans);
 }
 
 void Joint::update_T()
 {
-    mT->setMatrix(get_trans(mHeight));
-    for(int i = 0; i < mSphereCount; i++)
-    {
-        mTi[i]->setMatrix(get_trans(mHeight*i/mSphereCount + 1.0/mSphereCount + .25));
-    }
+    double height, radius;
+    get_size(height, radius);
+    mT->setMatrix(get_trans(height));
 }
 
 void Joint::set_size(double height, double radius)
 {
-    mHeight = height;
-    mRadius = radius;
-
-    mSphereCount = height/radius;
-    if(mSphereCount <= 0)
-        mSphereCount = 1;
-    mTi.clear();
-    for(int i = 0; i < mSphereCount; i++)
-    {
-        mTi.push_back(new osg::MatrixTransform);
-    }
+    mStore->set_size(index(), height, radius);
     update_T();
 }
 
 void Joint::get_size(double &height, double &radius)
 {
-    height = mHeight;
-    radius = mRadius;
+    mStore->get_size(index(), height, radius);
 }
 
 void Joint::set_color(double red, double green, double blue)
 {
-    mColor[0] = red;
-    mColor[1] = green;
-    mColor[2] = blue;
+    mStore->set_color(index(), red, green, blue);
 }
 
 void Joint::get_color(double &red, double &green, double &blue)
 {
-    red = mColor[0];
-    green = mColor[1];
-    blue = mColor[2];
+    mStore->get_color(index(), red, green, blue);
 }
 int Joint::get_sphere_count()
 {
-    return mSphereCount;
+    double height, radius;
+    get_size(height, radius);
+    return sphere_count(height, radius);
+}
+
+osg::Matrix to_matrix(const Frame &frame)
+{
+    return osg::Matrix(frame.r[0][0], frame.r[0][1], frame.r[0][2], 0,
+                       frame.r[1][0], frame.r[1][1], frame.r[1][2], 0,
+                       frame.r[2][0], frame.r[2][1], frame.r[2][2], 0,
+                       frame.t[0], frame.t[1], frame.t[2], 1);
+}
+
+Frame to_frame(const osg::Matrix &matrix)
+{
+    Frame frame;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            frame.r[i][j] = matrix(i,j);
+        frame.t[i] = matrix(3,i);
+    }
+    return frame;
 }
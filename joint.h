@@ -13,11 +13,16 @@
 #include <osg/ref_ptr>
 #include <osg/MatrixTransform>
 #include <vector>
+#include "kinematics.h"
+#include "jointstore.h"
 
+//Scene graph nodes for one joint. The joint's parameters live in a
+//JointStore, this class only keeps the transforms used to draw it.
 class Joint
 {
 public:
-    Joint(int id, double height, double radius);
+    Joint(JointStore *store, JointHandle handle);
+    JointHandle get_handle();
     int get_id();
     void set_id(int id);
     void get_axis(double &u, double &v);
@@ -28,23 +33,22 @@ public:
     void get_color(double &red, double &green, double &blue);
     int get_sphere_count();
     osg::MatrixTransform* get_T();
-    osg::MatrixTransform* get_Ti(int index);
+    void update_T();
 
 protected:
-    double mU;
-    double mV;
-    double mHeight;
-    double mRadius;
-    int mId;
-    double mColor[3];
-    int mSphereCount;
-    std::vector<osg::MatrixTransform*> mTi;
+    JointStore *mStore;
+    JointHandle mHandle;
 
-    osg::MatrixTransform *mT, *mT0, *mT1, *mT2, *mT3, *mT4;
+    //The spheres are drawn by OSGWidget's SphereInstancer, only the end cap has a node
+    osg::MatrixTransform *mT;
 private:
-    void update_T();
+    std::size_t index();
     osg::Matrix get_trans(double height);
 
 };
 
+//Conversions between the kinematics library and OpenSceneGraph
+osg::Matrix to_matrix(const Frame &frame);
+Frame to_frame(const osg::Matrix &matrix);
+
 #endif // JOINT_H
@@ -0,0 +1,173 @@
+//-------------------------------------------------------
+// Filename: jointstore.cpp
+//
+// Description: Contiguous structure-of-arrays storage for
+//              the joints of the arm.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "jointstore.h"
+
+JointStore::JointStore()
+{}
+
+std::size_t JointStore::size() const
+{
+    return mId.size();
+}
+
+bool JointStore::empty() const
+{
+    return mId.empty();
+}
+
+JointHandle JointStore::push_back(int id, double height, double radius)
+{
+    JointHandle handle = static_cast<JointHandle>(mIndex.size());
+    mIndex.push_back(static_cast<int>(mId.size()));
+    mHandle.push_back(handle);
+
+    mChain.push_back(0, 0, height);
+    mId.push_back(id);
+    mRadius.push_back(radius);
+    mRed.push_back(0);
+    mGreen.push_back(0);
+    mBlue.push_back(0);
+    return handle;
+}
+
+void JointStore::erase(std::size_t i)
+{
+    mIndex[mHandle[i]] = -1;
+
+    mChain.u.erase(mChain.u.begin()+i);
+    mChain.v.erase(mChain.v.begin()+i);
+    mChain.height.erase(mChain.height.begin()+i);
+    mId.erase(mId.begin()+i);
+    mRadius.erase(mRadius.begin()+i);
+    mRed.erase(mRed.begin()+i);
+    mGreen.erase(mGreen.begin()+i);
+    mBlue.erase(mBlue.begin()+i);
+    mHandle.erase(mHandle.begin()+i);
+
+    //Everything after i moved down one place
+    for (std::size_t k = i; k < mHandle.size(); k++)
+        mIndex[mHandle[k]] = static_cast<int>(k);
+}
+
+void JointStore::clear()
+{
+    //Handles are never reused, so old ones stay invalid
+    for (std::size_t k = 0; k < mHandle.size(); k++)
+        mIndex[mHandle[k]] = -1;
+
+    mChain.clear();
+    mId.clear();
+    mRadius.clear();
+    mRed.clear();
+    mGreen.clear();
+    mBlue.clear();
+    mHandle.clear();
+}
+
+JointHandle JointStore::handle(std::size_t i) const
+{
+    return mHandle[i];
+}
+
+int JointStore::index(JointHandle handle) const
+{
+    if (handle >= mIndex.size())
+        return -1;
+    return mIndex[handle];
+}
+
+int JointStore::get_id(std::size_t i) const
+{
+    return mId[i];
+}
+
+void JointStore::set_id(std::size_t i, int id)
+{
+    mId[i] = id;
+}
+
+void JointStore::get_axis(std::size_t i, double &u, double &v) const
+{
+    u = mChain.u[i];
+    v = mChain.v[i];
+}
+
+void JointStore::set_axis(std::size_t i, double u, double v)
+{
+    mChain.u[i] = u;
+    mChain.v[i] = v;
+}
+
+void JointStore::get_size(std::size_t i, double &height, double &radius) const
+{
+    height = mChain.height[i];
+    radius = mRadius[i];
+}
+
+void JointStore::set_size(std::size_t i, double height, double radius)
+{
+    mChain.height[i] = height;
+    mRadius[i] = radius;
+}
+
+void JointStore::get_color(std::size_t i, double &red, double &green, double &blue) const
+{
+    red = mRed[i];
+    green = mGreen[i];
+    blue = mBlue[i];
+}
+
+void JointStore::set_color(std::size_t i, double red, double green, double blue)
+{
+    mRed[i] = red;
+    mGreen[i] = green;
+    mBlue[i] = blue;
+}
+
+const Frame &JointStore::get_base() const
+{
+    return mChain.base;
+}
+
+void JointStore::set_base(const Frame &base)
+{
+    mChain.base = base;
+}
+
+const Chain &JointStore::chain() const
+{
+    return mChain;
+}
+
+const std::vector<int> &JointStore::ids() const
+{
+    return mId;
+}
+
+const std::vector<double> &JointStore::radius() const
+{
+    return mRadius;
+}
+
+const std::vector<double> &JointStore::red() const
+{
+    return mRed;
+}
+
+const std::vector<double> &JointStore::green() const
+{
+    return mGreen;
+}
+
+const std::vector<double> &JointStore::blue() const
+{
+    return mBlue;
+}
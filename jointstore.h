@@ -0,0 +1,71 @@
+//-------------------------------------------------------
+// Filename: jointstore.h
+//
+// Description: Contiguous structure-of-arrays storage for
+//              the joints of the arm. Joints are addressed
+//              by their position in the chain, and keep a
+//              stable handle while joints around them are
+//              added and removed.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef JOINTSTORE_H
+#define JOINTSTORE_H
+
+#include <cstddef>
+#include <vector>
+#include "kinematics.h"
+
+typedef unsigned int JointHandle;
+const JointHandle INVALID_JOINT = ~0u;
+
+class JointStore
+{
+public:
+    JointStore();
+    std::size_t size() const;
+    bool empty() const;
+    JointHandle push_back(int id, double height, double radius);
+    void erase(std::size_t i);
+    void clear();
+
+    JointHandle handle(std::size_t i) const;
+    //Position of a joint in the chain, or -1 once it has been erased
+    int index(JointHandle handle) const;
+
+    int get_id(std::size_t i) const;
+    void set_id(std::size_t i, int id);
+    void get_axis(std::size_t i, double &u, double &v) const;
+    void set_axis(std::size_t i, double u, double v);
+    void get_size(std::size_t i, double &height, double &radius) const;
+    void set_size(std::size_t i, double height, double radius);
+    void get_color(std::size_t i, double &red, double &green, double &blue) const;
+    void set_color(std::size_t i, double red, double green, double blue);
+
+    const Frame &get_base() const;
+    void set_base(const Frame &base);
+
+    //Flat views of every joint, in chain order
+    const Chain &chain() const;
+    const std::vector<int> &ids() const;
+    const std::vector<double> &radius() const;
+    const std::vector<double> &red() const;
+    const std::vector<double> &green() const;
+    const std::vector<double> &blue() const;
+
+protected:
+    Chain mChain;
+    std::vector<int> mId;
+    std::vector<double> mRadius;
+    std::vector<double> mRed;
+    std::vector<double> mGreen;
+    std::vector<double> mBlue;
+
+    //Chain position -> handle, and handle -> chain position
+    std::vector<JointHandle> mHandle;
+    std::vector<int> mIndex;
+};
+
+#endif // JOINTSTORE_H
@@ -0,0 +1,130 @@
+//-------------------------------------------------------
+// Filename: jointstore_test.cpp
+//
+// Description: Checks that joint handles stay stable and
+//              are never reused, and that the arrays of a
+//              JointStore stay aligned through erases.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+#include "jointstore.h"
+#include "testing.h"
+
+namespace {
+
+//Every value of joint k is derived from its id, so a joint that lost its
+//place in any one array shows up
+void add_joint(JointStore &joints, int id)
+{
+    joints.push_back(id, 1 + id, .5 + id);
+    std::size_t i = joints.size()-1;
+    joints.set_axis(i, .01*id, -.01*id);
+    joints.set_color(i, id % 256, (2*id) % 256, (3*id) % 256);
+}
+
+bool aligned(const JointStore &joints, std::size_t i)
+{
+    int id = joints.get_id(i);
+    double u, v, height, radius, red, green, blue;
+    joints.get_axis(i, u, v);
+    joints.get_size(i, height, radius);
+    joints.get_color(i, red, green, blue);
+    const Chain &chain = joints.chain();
+    return u == .01*id && v == -.01*id && height == 1 + id && radius == .5 + id &&
+            red == id % 256 && green == (2*id) % 256 && blue == (3*id) % 256 &&
+            chain.u[i] == u && chain.v[i] == v && chain.height[i] == height &&
+            joints.radius()[i] == radius && joints.ids()[i] == id && joints.red()[i] == red &&
+            joints.green()[i] == green && joints.blue()[i] == blue;
+}
+
+bool sizes_agree(const JointStore &joints)
+{
+    std::size_t n = joints.size();
+    const Chain &chain = joints.chain();
+    return chain.u.size() == n && chain.v.size() == n && chain.height.size() == n &&
+            joints.ids().size() == n && joints.radius().size() == n && joints.red().size() == n &&
+            joints.green().size() == n && joints.blue().size() == n;
+}
+
+void test_erase_before()
+{
+    JointStore joints;
+    for (int id = 0; id < 6; id++)
+        add_joint(joints, id);
+    JointHandle fourth = joints.handle(4);
+    JointHandle first = joints.handle(0);
+    JointHandle middle = joints.handle(2);
+
+    //Erasing joints in front of a joint moves it down but keeps its handle
+    joints.erase(2);
+    joints.erase(0);
+    CHECK(joints.size() == 4);
+    CHECK(joints.index(fourth) == 2);
+    CHECK(joints.handle(2) == fourth);
+    CHECK(joints.get_id(joints.index(fourth)) == 4);
+
+    //Erased handles stay invalid
+    CHECK(joints.index(first) == -1);
+    CHECK(joints.index(middle) == -1);
+    CHECK(joints.index(INVALID_JOINT) == -1);
+
+    //The middle erase left every array in step
+    CHECK(sizes_agree(joints));
+    for (std::size_t i = 0; i < joints.size(); i++)
+        CHECK(aligned(joints, i));
+}
+
+void test_no_reuse()
+{
+    JointStore joints;
+    std::set<JointHandle> seen;
+    std::vector<JointHandle> erased;
+    std::mt19937 random(5);
+    int id = 0;
+    for (int step = 0; step < 2000; step++)
+    {
+        if (joints.empty() || random() % 3 != 0)
+        {
+            add_joint(joints, id++);
+            JointHandle handle = joints.handle(joints.size()-1);
+            if (!CHECK(seen.insert(handle).second))
+                std::printf("  handle %u reused\n", handle);
+        }
+        else
+        {
+            std::size_t i = random() % joints.size();
+            erased.push_back(joints.handle(i));
+            joints.erase(i);
+        }
+        if (step == 1000)
+        {
+            for (std::size_t i = 0; i < joints.size(); i++)
+                erased.push_back(joints.handle(i));
+            joints.clear();
+        }
+    }
+
+    for (JointHandle handle : erased)
+        CHECK(joints.index(handle) == -1);
+    CHECK(sizes_agree(joints));
+    for (std::size_t i = 0; i < joints.size(); i++)
+    {
+        CHECK(joints.index(joints.handle(i)) == int(i));
+        CHECK(aligned(joints, i));
+    }
+}
+
+}
+
+int main()
+{
+    test_erase_before();
+    test_no_reuse();
+    return test_result();
+}
@@ -0,0 +1,272 @@
+//-------------------------------------------------------
+// Filename: kinematics.cpp
+//
+// Description: Constant-curvature kinematics for the soft
+//              robot chain.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "kinematics.h"
+#include "trace.h"
+#include <cmath>
+
+Chain::Chain():
+    base(identity_frame())
+{}
+
+std::size_t Chain::size() const
+{
+    return u.size();
+}
+
+void Chain::resize(std::size_t n)
+{
+    u.resize(n, 0);
+    v.resize(n, 0);
+    height.resize(n, 0);
+}
+
+void Chain::push_back(double u_i, double v_i, double height_i)
+{
+    u.push_back(u_i);
+    v.push_back(v_i);
+    height.push_back(height_i);
+}
+
+void Chain::clear()
+{
+    u.clear();
+    v.clear();
+    height.clear();
+}
+
+Frame identity_frame()
+{
+    return translate_frame(0, 0, 0);
+}
+
+Frame translate_frame(double x, double y, double z)
+{
+    Frame f;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            f.r[i][j] = (i == j) ? 1 : 0;
+    f.t[0] = x;
+    f.t[1] = y;
+    f.t[2] = z;
+    return f;
+}
+
+void compose(const Frame &a, const Frame &b, Frame &out)
+{
+    Frame f;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            f.r[i][j] = a.r[i][0]*b.r[0][j] + a.r[i][1]*b.r[1][j] + a.r[i][2]*b.r[2][j];
+    }
+    for (int j = 0; j < 3; j++)
+        f.t[j] = a.t[0]*b.r[0][j] + a.t[1]*b.r[1][j] + a.t[2]*b.r[2][j] + b.t[j];
+    out = f;
+}
+
+Frame compose(const Frame &a, const Frame &b)
+{
+    Frame f;
+    compose(a, b, f);
+    return f;
+}
+
+namespace {
+
+//sin(x)/x, with its Taylor series near zero so it stays smooth through x = 0
+double sinc(double x)
+{
+    double x2 = x*x;
+    if (x2 < 1e-4)
+        return 1 - x2/6*(1 - x2/20*(1 - x2/42));
+    return std::sin(x)/x;
+}
+
+}
+
+void arc_transform(double u, double v, double s, Frame &out)
+{
+    //R = I + A*W + B*W*W for the bend vector w = (u, v, 0), with
+    //A = sin(phi)/phi and B = (1 - cos(phi))/phi^2. Both only need sinc(phi/2):
+    //A = sinc(phi/2)*cos(phi/2), B = sinc(phi/2)^2/2
+    double phi2 = u*u + v*v;
+    double h = 0.5*std::sqrt(phi2);
+    double sh = sinc(h);
+    double a = sh*std::cos(h);
+    double b = 0.5*sh*sh;
+    double bu = b*u;
+    double bv = b*v;
+
+    out.r[0][0] = 1 - bv*v;
+    out.r[0][1] = bu*v;
+    out.r[0][2] = -a*v;
+    out.r[1][0] = bu*v;
+    out.r[1][1] = 1 - bu*u;
+    out.r[1][2] = a*u;
+    out.r[2][0] = a*v;
+    out.r[2][1] = -a*u;
+    out.r[2][2] = 1 - b*phi2;
+
+    out.t[0] = s*bv;
+    out.t[1] = -s*bu;
+    out.t[2] = s*a;
+}
+
+int sphere_count(double height, double radius)
+{
+    int count = height/radius;
+    if (count <= 0)
+        count = 1;
+    return count;
+}
+
+double sphere_arc_length(double height, int count, int k)
+{
+    return height*k/count + 1.0/count + .25;
+}
+
+void segment_transform(const Chain &chain, std::size_t i, double s, Frame &out)
+{
+    double scale_factor = s/chain.height[i];
+    arc_transform(chain.u[i]*scale_factor, chain.v[i]*scale_factor, s, out);
+}
+
+void forward_kinematics(const Chain &chain, std::vector<Frame> &out_frames)
+{
+    TRACE_SCOPE("forward_kinematics");
+    std::size_t n = chain.size();
+    out_frames.resize(n+1);
+    out_frames[0] = chain.base;
+
+    Frame seg;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        segment_transform(chain, i, chain.height[i], seg);
+        compose(seg, out_frames[i], out_frames[i+1]);
+        if (i+1 < n)
+        {
+            //ORDER OF MULTIPLICATION: First, offset. Second, joint matrix. Third, previous frame.
+            Frame &f = out_frames[i+1];
+            for (int j = 0; j < 3; j++)
+                f.t[j] += JOINT_GAP*f.r[2][j];
+        }
+    }
+}
+
+Frame joint_end_frame(const Chain &chain, const std::vector<Frame> &frames, std::size_t i)
+{
+    Frame f = frames[i+1];
+    if (i+1 < chain.size())
+    {
+        for (int j = 0; j < 3; j++)
+            f.t[j] -= JOINT_GAP*f.r[2][j];
+    }
+    return f;
+}
+
+FrameCache::FrameCache():
+    mValid{0}
+{}
+
+void FrameCache::invalidate(std::size_t joint)
+{
+    if (joint < mSegmentValid.size())
+        mSegmentValid[joint] = false;
+    if (joint < mValid)
+        mValid = joint;
+}
+
+void FrameCache::erase(std::size_t joint)
+{
+    if (joint >= mBase.size())
+        return;
+    mSegment.erase(mSegment.begin()+joint);
+    mSegmentValid.erase(mSegmentValid.begin()+joint);
+    mBase.erase(mBase.begin()+joint);
+    mEnd.erase(mEnd.begin()+joint);
+    if (joint < mValid)
+        mValid = joint;
+}
+
+void FrameCache::invalidate_base()
+{
+    mValid = 0;
+}
+
+void FrameCache::invalidate_all()
+{
+    mSegment.clear();
+    mSegmentValid.clear();
+    mBase.clear();
+    mEnd.clear();
+    mValid = 0;
+}
+
+const Frame &FrameCache::base_frame(const Chain &chain, std::size_t i)
+{
+    update(chain, i+1);
+    return mBase[i];
+}
+
+const Frame &FrameCache::end_frame(const Chain &chain, std::size_t i)
+{
+    update(chain, i+1);
+    return mEnd[i];
+}
+
+const Frame &FrameCache::end_effector(const Chain &chain)
+{
+    if (chain.size() == 0)
+        return chain.base;
+    return end_frame(chain, chain.size()-1);
+}
+
+void FrameCache::update(const Chain &chain, std::size_t count)
+{
+    std::size_t n = chain.size();
+    if (mBase.size() > n)
+    {
+        //Joints were removed without telling us which, start over
+        invalidate_all();
+    }
+    if (mBase.size() != n)
+    {
+        //Joints are only ever appended, so everything before them stays valid
+        mSegment.resize(n);
+        mSegmentValid.resize(n, false);
+        mBase.resize(n);
+        mEnd.resize(n);
+    }
+    if (count > n)
+        count = n;
+
+    for (std::size_t i = mValid; i < count; i++)
+    {
+        if (!mSegmentValid[i])
+        {
+            segment_transform(chain, i, chain.height[i], mSegment[i]);
+            mSegmentValid[i] = true;
+        }
+        if (i == 0)
+            mBase[i] = chain.base;
+        else
+        {
+            //ORDER OF MULTIPLICATION: First, offset. Second, previous joint end.
+            const Frame &prev = mEnd[i-1];
+            mBase[i] = prev;
+            for (int j = 0; j < 3; j++)
+                mBase[i].t[j] += JOINT_GAP*prev.r[2][j];
+        }
+        compose(mSegment[i], mBase[i], mEnd[i]);
+    }
+    if (count > mValid)
+        mValid = count;
+}
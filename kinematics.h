@@ -0,0 +1,120 @@
+//-------------------------------------------------------
+// Filename: kinematics.h
+//
+// Description: Constant-curvature kinematics for the soft
+//              robot chain. Plain data only, no Qt or
+//              OpenSceneGraph dependency.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <cstddef>
+#include <vector>
+
+//Rigid transform stored the same way osg::Matrix stores one:
+//a point p maps to p*r + t (row vector convention), so frames
+//compose left to right, a then b is compose(a, b).
+struct Frame
+{
+    double r[3][3];
+    double t[3];
+};
+
+//Plain data description of a chain of constant-curvature segments.
+//Joint i bends by (u[i], v[i]) radians over its full height[i].
+struct Chain
+{
+    Frame base;
+    std::vector<double> u;
+    std::vector<double> v;
+    std::vector<double> height;
+
+    Chain();
+    std::size_t size() const;
+    void resize(std::size_t n);
+    void push_back(double u_i, double v_i, double height_i);
+    void clear();
+};
+
+//Gap between the end of one segment and the base of the next
+const double JOINT_GAP = 1.0;
+//Largest bend the editor allows for u and v
+const double AXIS_LIMIT = 1.6;
+//Collision spheres are drawn at this fraction of the joint radius
+const double SPHERE_RADIUS_SCALE = 0.9;
+
+Frame identity_frame();
+Frame translate_frame(double x, double y, double z);
+void compose(const Frame &a, const Frame &b, Frame &out);
+Frame compose(const Frame &a, const Frame &b);
+
+//Transform from the base of an arc to a point at arc length s, where
+//(u, v) is the bend accumulated over that arc length.
+void arc_transform(double u, double v, double s, Frame &out);
+
+//Instruction set used by arc_transform_batch
+enum BatchKernel
+{
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2
+};
+
+//Evaluates arc_transform for n arcs at once, using the widest kernel the
+//CPU supports (picked on first use). The vector kernels use their own
+//sine/cosine, so results match arc_transform to within 1e-12 on each
+//rotation entry and 1e-12*s on each translation entry.
+void arc_transform_batch(const double *u, const double *v, const double *s, std::size_t n, Frame *out);
+BatchKernel batch_kernel();
+//Returns false and keeps the current kernel if this CPU or build cannot run it
+bool set_batch_kernel(BatchKernel kernel);
+
+//Number of collision spheres along a joint, and the arc length of sphere k
+int sphere_count(double height, double radius);
+double sphere_arc_length(double height, int count, int k);
+
+//Transform from the base of joint i to a point at arc length s on it
+void segment_transform(const Chain &chain, std::size_t i, double s, Frame &out);
+
+//out_frames[i] is the world frame at the base of joint i and
+//out_frames[chain.size()] is the end effector frame.
+void forward_kinematics(const Chain &chain, std::vector<Frame> &out_frames);
+
+//World frame at the end of joint i, read from forward_kinematics output
+Frame joint_end_frame(const Chain &chain, const std::vector<Frame> &frames, std::size_t i);
+
+//Cached prefix products of a chain with dirty tracking. Call invalidate(i)
+//after joint i changes: frames upstream of i are kept, and downstream frames
+//are only rebuilt up to the joint a query asks for. Queries on a clean cache
+//are O(1). Joints appended to the chain only cost their own frames; after
+//erasing joint i call erase(i) so the frames before it are kept.
+class FrameCache
+{
+public:
+    FrameCache();
+    void invalidate(std::size_t joint);
+    void erase(std::size_t joint);
+    void invalidate_base();
+    void invalidate_all();
+    const Frame &base_frame(const Chain &chain, std::size_t i);
+    const Frame &end_frame(const Chain &chain, std::size_t i);
+    const Frame &end_effector(const Chain &chain);
+
+protected:
+    //Transform from the base to the end of each segment
+    std::vector<Frame> mSegment;
+    std::vector<bool> mSegmentValid;
+    std::vector<Frame> mBase;
+    std::vector<Frame> mEnd;
+    //Joints [0, mValid) have valid base and end frames
+    std::size_t mValid;
+
+private:
+    void update(const Chain &chain, std::size_t count);
+};
+
+#endif // KINEMATICS_H
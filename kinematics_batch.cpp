@@ -0,0 +1,120 @@
+//-------------------------------------------------------
+// Filename: kinematics_batch.cpp
+//
+// Description: Runtime selection of the arc_transform_batch
+//              kernel.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "kinematics.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+bool arc_transform_batch_sse2(const double *u, const double *v, const double *s, std::size_t n, Frame *out);
+bool arc_transform_batch_avx2(const double *u, const double *v, const double *s, std::size_t n, Frame *out);
+
+namespace {
+
+bool cpu_has_avx2()
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+bool cpu_has_sse2()
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return false;
+#endif
+}
+
+//The kernel files report false when they were built without their instruction set
+bool kernel_available(BatchKernel kernel)
+{
+    double u = 0, v = 0, s = 0;
+    Frame f;
+    switch (kernel)
+    {
+    case KERNEL_AVX2:
+        return cpu_has_avx2() && arc_transform_batch_avx2(&u, &v, &s, 0, &f);
+    case KERNEL_SSE2:
+        return cpu_has_sse2() && arc_transform_batch_sse2(&u, &v, &s, 0, &f);
+    default:
+        return true;
+    }
+}
+
+BatchKernel detect_kernel()
+{
+    if (kernel_available(KERNEL_AVX2))
+        return KERNEL_AVX2;
+    if (kernel_available(KERNEL_SSE2))
+        return KERNEL_SSE2;
+    return KERNEL_SCALAR;
+}
+
+BatchKernel &active_kernel()
+{
+    static BatchKernel kernel = detect_kernel();
+    return kernel;
+}
+
+}
+
+BatchKernel batch_kernel()
+{
+    return active_kernel();
+}
+
+bool set_batch_kernel(BatchKernel kernel)
+{
+    if (!kernel_available(kernel))
+        return false;
+    active_kernel() = kernel;
+    return true;
+}
+
+void arc_transform_batch(const double *u, const double *v, const double *s, std::size_t n, Frame *out)
+{
+    switch (active_kernel())
+    {
+    case KERNEL_AVX2:
+        arc_transform_batch_avx2(u, v, s, n, out);
+        break;
+    case KERNEL_SSE2:
+        arc_transform_batch_sse2(u, v, s, n, out);
+        break;
+    default:
+        for (std::size_t i = 0; i < n; i++)
+            arc_transform(u[i], v[i], s[i], out[i]);
+        break;
+    }
+}
@@ -0,0 +1,76 @@
+//-------------------------------------------------------
+// Filename: kinematics_batch_avx2.cpp
+//
+// Description: AVX2 build of arc_transform_batch, four arcs
+//              per iteration. Only this file is compiled
+//              with AVX2 enabled; it is called only after
+//              the CPU has been checked.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "kinematics.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include "kinematics_simd.h"
+
+namespace {
+
+struct Avx2Vec
+{
+    static const int width = 4;
+    __m256d d;
+
+    Avx2Vec() {}
+    Avx2Vec(__m256d x): d(x) {}
+
+    static Avx2Vec set(double x) { return _mm256_set1_pd(x); }
+    static Avx2Vec load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, const Avx2Vec &x) { _mm256_storeu_pd(p, x.d); }
+    static Avx2Vec sqrt(const Avx2Vec &x) { return _mm256_sqrt_pd(x.d); }
+    static Avx2Vec less(const Avx2Vec &a, const Avx2Vec &b) { return _mm256_cmp_pd(a.d, b.d, _CMP_LT_OQ); }
+    static Avx2Vec select(const Avx2Vec &mask, const Avx2Vec &a, const Avx2Vec &b)
+    {
+        return _mm256_blendv_pd(b.d, a.d, mask.d);
+    }
+    static Avx2Vec round(const Avx2Vec &x)
+    {
+        return _mm256_round_pd(x.d, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    }
+    static void quadrant(const Avx2Vec &q, Avx2Vec &swap, Avx2Vec &sin_neg, Avx2Vec &cos_neg)
+    {
+        __m128i n = _mm256_cvtpd_epi32(q.d);
+        __m128i one = _mm_set1_epi32(1);
+        __m128i two = _mm_set1_epi32(2);
+        __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(n, one), one);
+        __m128i m2 = _mm_cmpeq_epi32(_mm_and_si128(n, two), two);
+        __m128i m3 = _mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(n, one), two), two);
+        swap = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(m1));
+        sin_neg = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(m2));
+        cos_neg = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(m3));
+    }
+};
+
+inline Avx2Vec operator+(const Avx2Vec &a, const Avx2Vec &b) { return _mm256_add_pd(a.d, b.d); }
+inline Avx2Vec operator-(const Avx2Vec &a, const Avx2Vec &b) { return _mm256_sub_pd(a.d, b.d); }
+inline Avx2Vec operator*(const Avx2Vec &a, const Avx2Vec &b) { return _mm256_mul_pd(a.d, b.d); }
+inline Avx2Vec operator/(const Avx2Vec &a, const Avx2Vec &b) { return _mm256_div_pd(a.d, b.d); }
+
+}
+
+bool arc_transform_batch_avx2(const double *u, const double *v, const double *s, std::size_t n, Frame *out)
+{
+    arc_transform_kernel<Avx2Vec>(u, v, s, n, out);
+    return true;
+}
+
+#else
+
+bool arc_transform_batch_avx2(const double *, const double *, const double *, std::size_t, Frame *)
+{
+    return false;
+}
+
+#endif
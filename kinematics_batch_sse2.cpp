@@ -0,0 +1,71 @@
+//-------------------------------------------------------
+// Filename: kinematics_batch_sse2.cpp
+//
+// Description: SSE2 build of arc_transform_batch, two arcs
+//              per iteration.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "kinematics.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#include "kinematics_simd.h"
+
+namespace {
+
+struct Sse2Vec
+{
+    static const int width = 2;
+    __m128d d;
+
+    Sse2Vec() {}
+    Sse2Vec(__m128d x): d(x) {}
+
+    static Sse2Vec set(double x) { return _mm_set1_pd(x); }
+    static Sse2Vec load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, const Sse2Vec &x) { _mm_storeu_pd(p, x.d); }
+    static Sse2Vec sqrt(const Sse2Vec &x) { return _mm_sqrt_pd(x.d); }
+    static Sse2Vec less(const Sse2Vec &a, const Sse2Vec &b) { return _mm_cmplt_pd(a.d, b.d); }
+    static Sse2Vec select(const Sse2Vec &mask, const Sse2Vec &a, const Sse2Vec &b)
+    {
+        return _mm_or_pd(_mm_and_pd(mask.d, a.d), _mm_andnot_pd(mask.d, b.d));
+    }
+    static Sse2Vec round(const Sse2Vec &x) { return _mm_cvtepi32_pd(_mm_cvtpd_epi32(x.d)); }
+    static void quadrant(const Sse2Vec &q, Sse2Vec &swap, Sse2Vec &sin_neg, Sse2Vec &cos_neg)
+    {
+        __m128i n = _mm_cvtpd_epi32(q.d);
+        __m128i one = _mm_set1_epi32(1);
+        __m128i two = _mm_set1_epi32(2);
+        __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(n, one), one);
+        __m128i m2 = _mm_cmpeq_epi32(_mm_and_si128(n, two), two);
+        __m128i m3 = _mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(n, one), two), two);
+        swap = _mm_castsi128_pd(_mm_unpacklo_epi32(m1, m1));
+        sin_neg = _mm_castsi128_pd(_mm_unpacklo_epi32(m2, m2));
+        cos_neg = _mm_castsi128_pd(_mm_unpacklo_epi32(m3, m3));
+    }
+};
+
+inline Sse2Vec operator+(const Sse2Vec &a, const Sse2Vec &b) { return _mm_add_pd(a.d, b.d); }
+inline Sse2Vec operator-(const Sse2Vec &a, const Sse2Vec &b) { return _mm_sub_pd(a.d, b.d); }
+inline Sse2Vec operator*(const Sse2Vec &a, const Sse2Vec &b) { return _mm_mul_pd(a.d, b.d); }
+inline Sse2Vec operator/(const Sse2Vec &a, const Sse2Vec &b) { return _mm_div_pd(a.d, b.d); }
+
+}
+
+bool arc_transform_batch_sse2(const double *u, const double *v, const double *s, std::size_t n, Frame *out)
+{
+    arc_transform_kernel<Sse2Vec>(u, v, s, n, out);
+    return true;
+}
+
+#else
+
+bool arc_transform_batch_sse2(const double *, const double *, const double *, std::size_t, Frame *)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,126 @@
+//-------------------------------------------------------
+// Filename: kinematics_simd.h
+//
+// Description: Vector kernel shared by the SSE2 and AVX2
+//              builds of arc_transform_batch. Each
+//              translation unit includes this with its own
+//              vector type, so everything stays in an
+//              unnamed namespace.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef KINEMATICS_SIMD_H
+#define KINEMATICS_SIMD_H
+
+#include "kinematics.h"
+
+namespace {
+
+//Sine and cosine of r in [-pi/4, pi/4] (fdlibm kernel polynomials)
+template <class V>
+inline void sincos_reduced(const V &r, V &s, V &c)
+{
+    V z = r*r;
+    V ps = V::set(1.58969099521155010221e-10);
+    ps = ps*z + V::set(-2.50507602534068634195e-08);
+    ps = ps*z + V::set(2.75573137070700676789e-06);
+    ps = ps*z + V::set(-1.98412698298579493134e-04);
+    ps = ps*z + V::set(8.33333333332248946124e-03);
+    ps = ps*z + V::set(-1.66666666666666324348e-01);
+    s = r + r*z*ps;
+
+    V pc = V::set(-1.13596475577881948265e-11);
+    pc = pc*z + V::set(2.08757232129817482790e-09);
+    pc = pc*z + V::set(-2.75573143513906633035e-07);
+    pc = pc*z + V::set(2.48015872894767294178e-05);
+    pc = pc*z + V::set(-1.38888888888741095749e-03);
+    pc = pc*z + V::set(4.16666666666666019037e-02);
+    c = V::set(1.0) - V::set(0.5)*z + z*z*pc;
+}
+
+//Sine and cosine for any |x| below about 1e6 (Cody-Waite reduction by pi/2)
+template <class V>
+inline void vec_sincos(const V &x, V &s, V &c)
+{
+    V q = V::round(x*V::set(6.36619772367581382433e-01));
+    V r = x - q*V::set(1.57079632673412561417e+00);
+    r = r - q*V::set(6.07710050630396597660e-11);
+    r = r - q*V::set(2.02226624879595063154e-21);
+
+    V rs, rc;
+    sincos_reduced(r, rs, rc);
+
+    //Quadrant n = q mod 4: sin = {s, c, -s, -c}[n], cos = {c, -s, -c, s}[n]
+    V swap, sin_neg, cos_neg;
+    V::quadrant(q, swap, sin_neg, cos_neg);
+    V ss = V::select(swap, rc, rs);
+    V cc = V::select(swap, rs, rc);
+    s = V::select(sin_neg, V::set(0.0) - ss, ss);
+    c = V::select(cos_neg, V::set(0.0) - cc, cc);
+}
+
+template <class V>
+void arc_transform_kernel(const double *u, const double *v, const double *s, std::size_t n, Frame *out)
+{
+    const int W = V::width;
+    double lanes[12][W];
+    std::size_t i = 0;
+
+    for (; i+W <= n; i += W)
+    {
+        V uu = V::load(u+i);
+        V vv = V::load(v+i);
+        V ss = V::load(s+i);
+        V phi2 = uu*uu + vv*vv;
+        V h = V::set(0.5)*V::sqrt(phi2);
+        V one = V::set(1.0);
+        V zero = V::set(0.0);
+
+        //Same closed form as arc_transform: A = sinc(h)*cos(h), B = sinc(h)^2/2
+        V small = V::less(h*h, V::set(1e-4));
+        V hs = V::select(small, one, h);
+        V sh, ch;
+        vec_sincos(h, sh, ch);
+        V x2 = h*h;
+        V taylor = one - x2*V::set(1.0/6)*(one - x2*V::set(1.0/20)*(one - x2*V::set(1.0/42)));
+        V sc = V::select(small, taylor, sh/hs);
+        V a = sc*ch;
+        V b = V::set(0.5)*sc*sc;
+        V bu = b*uu;
+        V bv = b*vv;
+
+        V m[12];
+        m[0] = one - bv*vv;
+        m[1] = bu*vv;
+        m[2] = zero - a*vv;
+        m[3] = bu*vv;
+        m[4] = one - bu*uu;
+        m[5] = a*uu;
+        m[6] = a*vv;
+        m[7] = zero - a*uu;
+        m[8] = one - b*phi2;
+        m[9] = ss*bv;
+        m[10] = zero - ss*bu;
+        m[11] = ss*a;
+        for (int k = 0; k < 12; k++)
+            V::store(lanes[k], m[k]);
+
+        for (int l = 0; l < W; l++)
+        {
+            Frame &f = out[i+l];
+            for (int k = 0; k < 9; k++)
+                f.r[k/3][k%3] = lanes[k][l];
+            for (int k = 0; k < 3; k++)
+                f.t[k] = lanes[9+k][l];
+        }
+    }
+
+    for (; i < n; i++)
+        arc_transform(u[i], v[i], s[i], out[i]);
+}
+
+}
+
+#endif // KINEMATICS_SIMD_H
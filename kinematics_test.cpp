@@ -0,0 +1,270 @@
+//-------------------------------------------------------
+// Filename: kinematics_test.cpp
+//
+// Description: Checks arc_transform against the axis-angle
+//              form it replaced, every batch kernel against
+//              arc_transform, the analytic Jacobian
+//              against finite differences, and the frame
+//              cache against forward_kinematics.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "jacobian.h"
+#include "kinematics.h"
+#include "testing.h"
+
+namespace {
+
+//Rotation of phi about the unit axis (u, v, 0)/phi, then the arc translation,
+//laid out the way osg::Matrix::rotate did it. Long double, with 1 - cos written
+//as 2 sin^2(phi/2), so it stays accurate down to tiny bends.
+void reference_arc(double u, double v, double s, Frame &out)
+{
+    long double phi = std::sqrt((long double)u*u + (long double)v*v);
+    if (phi == 0)
+    {
+        out = translate_frame(0, 0, s);
+        return;
+    }
+    long double x = u/phi;
+    long double y = v/phi;
+    long double sp = std::sin(phi);
+    long double cp = std::cos(phi);
+    long double sh = std::sin(phi/2);
+    long double c1 = 2*sh*sh;
+
+    out.r[0][0] = cp + c1*x*x;
+    out.r[0][1] = c1*x*y;
+    out.r[0][2] = -sp*y;
+    out.r[1][0] = c1*x*y;
+    out.r[1][1] = cp + c1*y*y;
+    out.r[1][2] = sp*x;
+    out.r[2][0] = sp*y;
+    out.r[2][1] = -sp*x;
+    out.r[2][2] = cp;
+    out.t[0] = c1*s*y/phi;
+    out.t[1] = -c1*s*x/phi;
+    out.t[2] = s*sp/phi;
+}
+
+double frame_error(const Frame &a, const Frame &b, double s)
+{
+    double error = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            error = std::max(error, std::fabs(a.r[i][j] - b.r[i][j]));
+        error = std::max(error, std::fabs(a.t[i] - b.t[i])/std::max(1.0, s));
+    }
+    return error;
+}
+
+//Bends from zero curvature, through the Taylor branch edge (phi/2 = 1e-2),
+//up to past the editor limit
+double random_bend(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> unit(-1, 1);
+    std::uniform_int_distribution<int> scale(0, 5);
+    static const double scales[] = {0, 1e-9, 1e-4, 2e-2, 0.5, 3};
+    return scales[scale(rng)]*unit(rng);
+}
+
+void test_arc_transform()
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> length(0.1, 20);
+    double worst = 0;
+    for (int k = 0; k < 100000; k++)
+    {
+        double u = random_bend(rng);
+        double v = random_bend(rng);
+        double s = length(rng);
+        Frame a, b;
+        arc_transform(u, v, s, a);
+        reference_arc(u, v, s, b);
+        worst = std::max(worst, frame_error(a, b, s));
+    }
+    CHECK(worst < 1e-14);
+
+    //Both sides of where sinc switches to its Taylor series are exact, so
+    //there is no jump at the switch
+    double edge = 2*std::sqrt(1e-4);
+    static const double offsets[] = {-1e-9, -1e-15, 0, 1e-15, 1e-9};
+    for (int k = 0; k < 5; k++)
+    {
+        Frame a, b;
+        double u = .6*edge*(1 + offsets[k]);
+        double v = .8*edge*(1 + offsets[k]);
+        arc_transform(u, v, 5, a);
+        reference_arc(u, v, 5, b);
+        CHECK(frame_error(a, b, 5) < 1e-15);
+    }
+}
+
+void test_batch_kernels()
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> length(0.1, 20);
+    //Not a multiple of any vector width, so the scalar tail runs too
+    const std::size_t n = 10007;
+    std::vector<double> u(n), v(n), s(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        u[i] = random_bend(rng);
+        v[i] = random_bend(rng);
+        s[i] = length(rng);
+    }
+    std::vector<Frame> expected(n), out(n);
+    for (std::size_t i = 0; i < n; i++)
+        arc_transform(u[i], v[i], s[i], expected[i]);
+
+    BatchKernel detected = batch_kernel();
+    static const BatchKernel kernels[] = {KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2};
+    for (int k = 0; k < 3; k++)
+    {
+        if (!set_batch_kernel(kernels[k]))
+        {
+            std::printf("kernel %d not available, skipped\n", int(kernels[k]));
+            continue;
+        }
+        CHECK(batch_kernel() == kernels[k]);
+        arc_transform_batch(&u[0], &v[0], &s[0], n, &out[0]);
+        double worst = 0;
+        for (std::size_t i = 0; i < n; i++)
+            worst = std::max(worst, frame_error(out[i], expected[i], s[i]));
+        CHECK(worst < 1e-12);
+    }
+    CHECK(set_batch_kernel(detected));
+}
+
+//World angular velocity between two rotations a small step apart:
+//b = a*D, and D = I + [w] in the row vector convention
+void rotation_difference(const Frame &a, const Frame &b, double w[3])
+{
+    double d[3][3];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            d[i][j] = a.r[0][i]*b.r[0][j] + a.r[1][i]*b.r[1][j] + a.r[2][i]*b.r[2][j];
+    w[0] = 0.5*(d[1][2] - d[2][1]);
+    w[1] = 0.5*(d[2][0] - d[0][2]);
+    w[2] = 0.5*(d[0][1] - d[1][0]);
+}
+
+void test_jacobian()
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> bend(-1.2, 1.2);
+    Chain chain;
+    for (int i = 0; i < 8; i++)
+        chain.push_back(bend(rng), bend(rng), 3 + i%3);
+    //One straight joint, so the Taylor branch is covered
+    chain.u[4] = 0;
+    chain.v[4] = 1e-5;
+
+    ChainJacobian jacobian;
+    jacobian.compute(chain);
+    std::vector<double> j;
+    jacobian.end_effector(j);
+    std::size_t cols = 2*chain.size();
+    CHECK(j.size() == 6*cols);
+
+    std::vector<Frame> frames;
+    forward_kinematics(chain, frames);
+    for (std::size_t i = 0; i <= chain.size(); i++)
+        CHECK(frame_error(frames[i], jacobian.frames()[i], 1) < 1e-13);
+
+    const double step = 1e-6;
+    for (std::size_t col = 0; col < cols; col++)
+    {
+        std::vector<double> &param = col%2 ? chain.v : chain.u;
+        double saved = param[col/2];
+        std::vector<Frame> plus, minus;
+        param[col/2] = saved + step;
+        forward_kinematics(chain, plus);
+        param[col/2] = saved - step;
+        forward_kinematics(chain, minus);
+        param[col/2] = saved;
+
+        const Frame &p = plus.back();
+        const Frame &m = minus.back();
+        double w[3];
+        rotation_difference(m, p, w);
+        for (int r = 0; r < 3; r++)
+        {
+            CHECK_NEAR(j[r*cols+col], (p.t[r] - m.t[r])/(2*step), 1e-6);
+            CHECK_NEAR(j[(3+r)*cols+col], w[r]/(2*step), 1e-6);
+        }
+    }
+
+    //Joints at or past frame k do not move it
+    jacobian.at_frame(3, j);
+    for (std::size_t col = 6; col < cols; col++)
+        for (int r = 0; r < 6; r++)
+            CHECK(j[r*cols+col] == 0);
+}
+
+void test_frame_cache()
+{
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> bend(-1, 1);
+    Chain chain;
+    FrameCache cache;
+    std::vector<Frame> frames;
+
+    //Joints appended one at a time match forward_kinematics
+    for (int i = 0; i < 20; i++)
+    {
+        chain.push_back(bend(rng), bend(rng), 2 + i%4);
+        cache.invalidate(chain.size()-1);
+        forward_kinematics(chain, frames);
+        for (std::size_t k = 0; k < chain.size(); k++)
+        {
+            CHECK(frame_error(cache.base_frame(chain, k), frames[k], 1) < 1e-12);
+            CHECK(frame_error(cache.end_frame(chain, k), joint_end_frame(chain, frames, k), 1) < 1e-12);
+        }
+    }
+
+    //An append reuses the cached prefix: a change nobody was told about stays
+    //invisible to the cache, while the new joint is still computed
+    Frame before = cache.end_frame(chain, 0);
+    chain.u[0] += .5;
+    chain.push_back(.3, .2, 4);
+    CHECK(frame_error(cache.end_frame(chain, 0), before, 1) == 0);
+    Frame stale = cache.end_effector(chain);
+    cache.invalidate(0);
+    forward_kinematics(chain, frames);
+    CHECK(frame_error(stale, frames.back(), 1) > 1e-6);
+    CHECK(frame_error(cache.end_effector(chain), frames.back(), 1) < 1e-12);
+
+    //Erasing a joint in the middle keeps the frames before it
+    std::size_t gone = 7;
+    chain.u.erase(chain.u.begin()+gone);
+    chain.v.erase(chain.v.begin()+gone);
+    chain.height.erase(chain.height.begin()+gone);
+    cache.erase(gone);
+    forward_kinematics(chain, frames);
+    for (std::size_t k = 0; k < chain.size(); k++)
+        CHECK(frame_error(cache.base_frame(chain, k), frames[k], 1) < 1e-12);
+
+    //Shrinking without erase() still gives the right frames
+    chain.resize(5);
+    forward_kinematics(chain, frames);
+    CHECK(frame_error(cache.end_effector(chain), frames.back(), 1) < 1e-12);
+}
+
+}
+
+int main()
+{
+    test_arc_transform();
+    test_batch_kernels();
+    test_jacobian();
+    test_frame_cache();
+    return test_result();
+}
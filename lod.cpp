@@ -0,0 +1,92 @@
+//-------------------------------------------------------
+// Filename: lod.cpp
+//
+// Description: Screen-space level of detail with
+//              hysteresis, so objects near a threshold
+//              do not flicker between levels.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "lod.h"
+#include <osg/ShapeDrawable>
+#include <osgUtil/CullVisitor>
+#include <algorithm>
+
+namespace {
+
+int level_for(double pixels, const double *thresholds, int count)
+{
+    int level = 0;
+    while (level < count && pixels <= thresholds[level])
+        level++;
+    return level;
+}
+
+}
+
+int lod_level(double pixels, int current, const double *thresholds, int count)
+{
+    //Finer only if still finer with the size shrunk, coarser only if still coarser with it grown
+    int finer = level_for(pixels/LOD_HYSTERESIS, thresholds, count);
+    int coarser = level_for(pixels*LOD_HYSTERESIS, thresholds, count);
+    if (finer < current)
+        return finer;
+    if (coarser > current)
+        return coarser;
+    return current;
+}
+
+HysteresisLod::HysteresisLod():
+    mCount{0},
+    mLevel{0}
+{}
+
+HysteresisLod::~HysteresisLod()
+{}
+
+void HysteresisLod::set_thresholds(const double *thresholds, int count)
+{
+    mCount = std::min(count, int(sizeof(mThresholds)/sizeof(mThresholds[0])));
+    std::copy(thresholds, thresholds+mCount, mThresholds);
+}
+
+int HysteresisLod::level() const
+{
+    return mLevel;
+}
+
+void HysteresisLod::traverse(osg::NodeVisitor &nv)
+{
+    if (getNumChildren() == 0)
+        return;
+
+    osgUtil::CullVisitor *cv = dynamic_cast<osgUtil::CullVisitor*>(&nv);
+    if (!cv)
+    {
+        //Updates and intersections see every level
+        osg::Group::traverse(nv);
+        return;
+    }
+
+    const osg::BoundingSphere &bound = getBound();
+    mLevel = lod_level(cv->clampedPixelSize(bound), mLevel, mThresholds, mCount);
+    mLevel = std::min<int>(mLevel, getNumChildren()-1);
+    getChild(mLevel)->accept(nv);
+}
+
+void set_shape_color(osg::Node *node, const osg::Vec4 &color)
+{
+    if (!node)
+        return;
+    osg::ShapeDrawable *sd = dynamic_cast<osg::ShapeDrawable*>(node);
+    if (sd)
+    {
+        sd->setColor(color);
+        return;
+    }
+    osg::Group *group = node->asGroup();
+    for (unsigned i = 0; group && i < group->getNumChildren(); i++)
+        set_shape_color(group->getChild(i), color);
+}
@@ -0,0 +1,47 @@
+//-------------------------------------------------------
+// Filename: lod.h
+//
+// Description: Screen-space level of detail with
+//              hysteresis, so objects near a threshold
+//              do not flicker between levels.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef LOD_H
+#define LOD_H
+
+#include <osg/Group>
+#include <osg/Vec4>
+
+//Levels are 0 (finest) to count, level i is used while the pixel size is
+//above thresholds[i]. A level only changes once the size is past the
+//threshold by the hysteresis factor, so small camera moves never toggle it.
+const double LOD_HYSTERESIS = 1.25;
+int lod_level(double pixels, int current, const double *thresholds, int count);
+
+//Draws one of its children, picked during the cull traversal from the
+//projected size of its bound. Child 0 is the most detailed.
+class HysteresisLod : public osg::Group
+{
+public:
+    HysteresisLod();
+    //One threshold less than the number of children
+    void set_thresholds(const double *thresholds, int count);
+    int level() const;
+    virtual void traverse(osg::NodeVisitor &nv);
+
+protected:
+    virtual ~HysteresisLod();
+
+private:
+    double mThresholds[8];
+    int mCount;
+    int mLevel;
+};
+
+//Sets the color of every ShapeDrawable at or under node
+void set_shape_color(osg::Node *node, const osg::Vec4 &color);
+
+#endif // LOD_H
@@ -0,0 +1,444 @@
+//-------------------------------------------------------
+// Filename: macro.cpp
+//
+// Description: A recorded macro, one joint change per
+//              line, split into playback frames. Macros
+//              are read from text or from a memory-mapped
+//              binary file.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "macro.h"
+#include "trace.h"
+#include <QObject>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char MAGIC[8] = {'S', 'R', 'M', 'A', 'C', 'R', 'O', '\0'};
+const quint32 VERSION = 2;
+
+struct MacroHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 record_size;
+    quint64 line_count;
+    quint64 frame_count;
+    quint64 initial_lines;
+    //Byte offset of the frame index, right after the lines
+    quint64 index_offset;
+    //Version 2 and later
+    quint64 keyframe_joints;
+    quint64 keyframe_count;
+    quint64 keyframe_offset;
+};
+
+//Version 1 headers stop before the keyframe fields
+const std::size_t HEADER_V1_SIZE = 48;
+
+static_assert(sizeof(MacroLine) == 24, "MacroLine must match the file record");
+static_assert(sizeof(MacroHeader) == 72, "MacroHeader must match the file header");
+
+}
+
+Macro::Macro():
+    mLines{0},
+    mCount{0},
+    mFrameStart{0},
+    mFrameCount{0},
+    mKeyFrame{0},
+    mKeyState{0},
+    mKeyCount{0},
+    mKeyJoints{0},
+    mMap{0},
+    mInitialLines{0}
+{}
+
+Macro::~Macro()
+{
+    clear();
+}
+
+bool Macro::load(const QString &filename)
+{
+    TRACE_SCOPE("macro_load");
+    QFile file(filename);
+    char magic[sizeof(MAGIC)];
+    if (file.open(QIODevice::ReadOnly) && file.read(magic, sizeof(magic)) == sizeof(magic)
+            && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0)
+        return load_binary(filename);
+    return load_text(filename);
+}
+
+bool Macro::load_text(const QString &filename)
+{
+    clear();
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        mError = QObject::tr("Cannot Read File");
+        return false;
+    }
+
+    QTextStream in(&file);
+    int line_count = 0;
+    while (!in.atEnd())
+    {
+        QStringList line = in.readLine().split(" ");
+        bool ok_joint, ok_u, ok_v;
+        unsigned joint = line.size() == 3 ? line[0].toUInt(&ok_joint) : 0;
+        double u = line.size() == 3 ? line[1].toDouble(&ok_u) : 0;
+        double v = line.size() == 3 ? line[2].toDouble(&ok_v) : 0;
+        if (line.size() != 3 || !ok_joint || !ok_u || !ok_v || joint >= MAX_JOINTS)
+        {
+            clear();
+            mError = QObject::tr("Invalid Macro Line: %1").arg(line_count);
+            return false;
+        }
+        push_back(joint, u, v);
+        line_count++;
+    }
+
+    //Recording writes joints 0..N-1 first, which is the first frame
+    std::size_t initial = 0;
+    while (initial < mCount && mLines[initial].joint == initial)
+        initial++;
+    mInitialLines = initial;
+    return true;
+}
+
+bool Macro::load_binary(const QString &filename)
+{
+    clear();
+    mFile.setFileName(filename);
+    if (!mFile.open(QIODevice::ReadOnly))
+    {
+        mError = QObject::tr("Cannot Read File");
+        return false;
+    }
+
+    qint64 file_size = mFile.size();
+    if (file_size >= qint64(HEADER_V1_SIZE))
+        mMap = mFile.map(0, file_size);
+    if (!mMap)
+    {
+        clear();
+        mError = QObject::tr("Cannot map macro file");
+        return false;
+    }
+
+    MacroHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(&header, mMap, HEADER_V1_SIZE);
+    std::size_t header_size = HEADER_V1_SIZE;
+    if (header.version >= 2 && file_size >= qint64(sizeof(header)))
+    {
+        std::memcpy(&header, mMap, sizeof(header));
+        header_size = sizeof(header);
+    }
+
+    quint64 size = quint64(file_size);
+    quint64 lines_end = header_size + header.line_count*sizeof(MacroLine);
+    quint64 index_end = header.index_offset + (header.frame_count+1)*sizeof(quint64);
+    bool valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+            && (header.version == 1 || (header.version == VERSION && header_size == sizeof(header)))
+            && header.record_size == sizeof(MacroLine)
+            && header.line_count <= size/sizeof(MacroLine)
+            && header.index_offset <= size
+            && header.index_offset >= lines_end
+            && header.index_offset % sizeof(quint64) == 0
+            && header.frame_count < size/sizeof(quint64)
+            && index_end <= size;
+    if (valid && header.keyframe_count > 0)
+    {
+        //Checked piece by piece so none of the products can overflow
+        quint64 states = header.keyframe_count*2;
+        valid = header.keyframe_offset >= index_end
+                && header.keyframe_offset <= size
+                && header.keyframe_offset % sizeof(quint64) == 0
+                && header.keyframe_count <= size/sizeof(quint64)
+                && header.keyframe_joints <= MAX_JOINTS
+                && (header.keyframe_joints == 0 || states <= size/sizeof(double)/header.keyframe_joints)
+                && header.keyframe_count*sizeof(quint64) + states*header.keyframe_joints*sizeof(double) <= size - header.keyframe_offset;
+    }
+    if (!valid)
+    {
+        clear();
+        mError = QObject::tr("Not a macro file, or it was written by a newer version");
+        return false;
+    }
+
+    mLines = reinterpret_cast<const MacroLine*>(mMap + header_size);
+    mCount = header.line_count;
+    mFrameStart = reinterpret_cast<const quint64*>(mMap + header.index_offset);
+    mFrameCount = header.frame_count;
+    mInitialLines = header.initial_lines;
+    if (header.keyframe_count > 0)
+    {
+        mKeyFrame = reinterpret_cast<const quint64*>(mMap + header.keyframe_offset);
+        mKeyState = reinterpret_cast<const double*>(mMap + header.keyframe_offset + header.keyframe_count*sizeof(quint64));
+        mKeyCount = header.keyframe_count;
+        mKeyJoints = header.keyframe_joints;
+    }
+
+    //Indices must be in order and inside the file, or frame_lines could read past it
+    bool ordered = mFrameStart[0] == 0 && mFrameStart[mFrameCount] == mCount;
+    for (std::size_t f = 0; f < mFrameCount && ordered; f++)
+        ordered = mFrameStart[f] <= mFrameStart[f+1];
+    for (std::size_t k = 0; k < mKeyCount && ordered; k++)
+        ordered = mKeyFrame[k] < mFrameCount && (k == 0 || mKeyFrame[k-1] < mKeyFrame[k]);
+    if (!ordered)
+    {
+        clear();
+        mError = QObject::tr("Corrupt macro frame index");
+        return false;
+    }
+    for (std::size_t i = 0; i < mCount; i++)
+    {
+        if (mLines[i].joint >= MAX_JOINTS)
+        {
+            clear();
+            mError = QObject::tr("Invalid Macro Line: %1").arg(quint64(i));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Macro::write_binary(const QString &filename) const
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    //Keyframes the macro already has are kept, otherwise they are built now
+    std::vector<quint64> key_frames;
+    std::vector<double> key_states;
+    std::size_t key_joints = mKeyJoints;
+    if (mKeyCount > 0)
+    {
+        key_frames.assign(mKeyFrame, mKeyFrame+mKeyCount);
+        key_states.assign(mKeyState, mKeyState+2*mKeyCount*mKeyJoints);
+    }
+    else
+        compute_keyframes(KEYFRAME_INTERVAL, key_frames, key_states, key_joints);
+
+    MacroHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.record_size = sizeof(MacroLine);
+    header.line_count = mCount;
+    header.frame_count = frame_count();
+    header.initial_lines = mInitialLines;
+    header.index_offset = sizeof(MacroHeader) + mCount*sizeof(MacroLine);
+    header.keyframe_joints = key_joints;
+    header.keyframe_count = key_frames.size();
+    header.keyframe_offset = header.index_offset + (header.frame_count+1)*sizeof(quint64);
+
+    std::vector<quint64> index(header.frame_count+1, 0);
+    for (std::size_t f = 0; f < header.frame_count; f++)
+    {
+        std::size_t first, last;
+        frame_lines(f, first, last);
+        index[f] = first;
+        index[f+1] = last;
+    }
+
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header));
+    ok = ok && file.write(reinterpret_cast<const char*>(mLines), mCount*sizeof(MacroLine)) == qint64(mCount*sizeof(MacroLine));
+    ok = ok && file.write(reinterpret_cast<const char*>(index.data()), index.size()*sizeof(quint64)) == qint64(index.size()*sizeof(quint64));
+    ok = ok && file.write(reinterpret_cast<const char*>(key_frames.data()), key_frames.size()*sizeof(quint64)) == qint64(key_frames.size()*sizeof(quint64));
+    ok = ok && file.write(reinterpret_cast<const char*>(key_states.data()), key_states.size()*sizeof(double)) == qint64(key_states.size()*sizeof(double));
+    return ok;
+}
+
+QString Macro::error_string() const
+{
+    return mError;
+}
+
+void Macro::clear()
+{
+    if (mMap)
+        mFile.unmap(mMap);
+    mMap = 0;
+    if (mFile.isOpen())
+        mFile.close();
+    mOwned.clear();
+    mLines = 0;
+    mCount = 0;
+    mFrameStart = 0;
+    mFrameCount = 0;
+    clear_keyframes();
+    mError.clear();
+}
+
+void Macro::push_back(unsigned joint, double u, double v)
+{
+    if (mMap)
+    {
+        //Mapped files are read only, so keep a copy from here on
+        std::vector<MacroLine> lines(mLines, mLines+mCount);
+        std::size_t initial = mInitialLines;
+        clear();
+        mOwned.swap(lines);
+        mInitialLines = initial;
+    }
+    //The new line may belong to the last keyframe's frame
+    clear_keyframes();
+    MacroLine line;
+    line.joint = joint;
+    line.flags = 0;
+    line.u = u;
+    line.v = v;
+    mOwned.push_back(line);
+    mLines = mOwned.data();
+    mCount = mOwned.size();
+}
+
+std::size_t Macro::size() const
+{
+    return mCount;
+}
+
+const MacroLine &Macro::line(std::size_t i) const
+{
+    return mLines[i];
+}
+
+void Macro::set_initial_lines(std::size_t count)
+{
+    if (!mFrameStart && count != mInitialLines)
+    {
+        //Frames move, and the keyframes with them
+        mInitialLines = count;
+        clear_keyframes();
+    }
+}
+
+std::size_t Macro::initial_lines() const
+{
+    return mInitialLines;
+}
+
+std::size_t Macro::frame_count() const
+{
+    if (mFrameStart)
+        return mFrameCount;
+    if (size() == 0)
+        return 0;
+    return size() - first_frame_lines() + 1;
+}
+
+void Macro::frame_lines(std::size_t f, std::size_t &first, std::size_t &last) const
+{
+    if (mFrameStart)
+    {
+        first = mFrameStart[f];
+        last = mFrameStart[f+1];
+        return;
+    }
+    std::size_t initial = first_frame_lines();
+    first = (f == 0) ? 0 : initial + f - 1;
+    last = initial + f;
+}
+
+std::size_t Macro::first_frame_lines() const
+{
+    //Frame 0 always has at least one line, and never more than the macro
+    return std::max<std::size_t>(1, std::min(mInitialLines, size()));
+}
+
+void Macro::build_keyframes(std::size_t interval)
+{
+    std::vector<quint64> frames;
+    std::vector<double> states;
+    std::size_t joints;
+    compute_keyframes(interval, frames, states, joints);
+    mOwnedKeyFrame.swap(frames);
+    mOwnedKeyState.swap(states);
+    mKeyFrame = mOwnedKeyFrame.data();
+    mKeyState = mOwnedKeyState.data();
+    mKeyCount = mOwnedKeyFrame.size();
+    mKeyJoints = joints;
+}
+
+void Macro::clear_keyframes()
+{
+    mOwnedKeyFrame.clear();
+    mOwnedKeyState.clear();
+    mKeyFrame = 0;
+    mKeyState = 0;
+    mKeyCount = 0;
+    mKeyJoints = 0;
+}
+
+std::size_t Macro::keyframe_count() const
+{
+    return mKeyCount;
+}
+
+std::size_t Macro::keyframe_joints() const
+{
+    return mKeyJoints;
+}
+
+std::size_t Macro::keyframe_frame(std::size_t k) const
+{
+    return mKeyFrame[k];
+}
+
+const double *Macro::keyframe_state(std::size_t k) const
+{
+    return mKeyState + 2*k*mKeyJoints;
+}
+
+bool Macro::find_keyframe(std::size_t frame, std::size_t &k) const
+{
+    const quint64 *it = std::upper_bound(mKeyFrame, mKeyFrame+mKeyCount, quint64(frame));
+    if (it == mKeyFrame)
+        return false;
+    k = (it - mKeyFrame) - 1;
+    return true;
+}
+
+void Macro::compute_keyframes(std::size_t interval, std::vector<quint64> &frames, std::vector<double> &states, std::size_t &joints) const
+{
+    interval = std::max<std::size_t>(1, interval);
+    //Loading rejects larger joints, this only guards lines added by push_back
+    joints = 0;
+    for (std::size_t i = 0; i < mCount; i++)
+    {
+        if (mLines[i].joint < MAX_JOINTS)
+            joints = std::max<std::size_t>(joints, mLines[i].joint+std::size_t(1));
+    }
+
+    std::vector<double> state(2*joints, std::numeric_limits<double>::quiet_NaN());
+    frames.clear();
+    states.clear();
+    std::size_t count = frame_count();
+    for (std::size_t f = 0; f < count; f++)
+    {
+        std::size_t first, last;
+        frame_lines(f, first, last);
+        for (std::size_t i = first; i < last; i++)
+        {
+            if (mLines[i].joint >= joints)
+                continue;
+            state[2*mLines[i].joint] = mLines[i].u;
+            state[2*mLines[i].joint+1] = mLines[i].v;
+        }
+        if (f % interval == 0)
+        {
+            frames.push_back(f);
+            states.insert(states.end(), state.begin(), state.end());
+        }
+    }
+}
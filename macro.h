@@ -0,0 +1,112 @@
+//-------------------------------------------------------
+// Filename: macro.h
+//
+// Description: A recorded macro, one joint change per
+//              line, split into playback frames. Macros
+//              are read from text or from a memory-mapped
+//              binary file.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef MACRO_H
+#define MACRO_H
+
+#include <QFile>
+#include <QString>
+#include <vector>
+
+//Same layout as a record in the binary file, so mapped files are read in place
+struct MacroLine
+{
+    quint32 joint;
+    quint32 flags;
+    double u;
+    double v;
+};
+
+//Recording starts by writing every joint once, so frame 0 is the first
+//initial_lines lines of the macro and each line after that is one frame.
+//
+//Binary macros (.srm) are little-endian: a 72 byte header, the lines as
+//MacroLine records, then frame_count+1 64-bit line indices where frame f
+//is lines [index[f], index[f+1]), then the keyframes: keyframe_count frame
+//numbers followed by keyframe_joints (u, v) pairs per keyframe. Version 1
+//files have a 48 byte header and no keyframes.
+//
+//Keyframe k is the state of every joint once frames [0, keyframe_frame(k)]
+//have been applied. Joints the macro has not set yet are NaN.
+//
+//Keyframes hold every joint up to the largest one a line names, so loading
+//rejects lines naming joint MAX_JOINTS or above.
+class Macro
+{
+public:
+    Macro();
+    ~Macro();
+    //Binary or text, picked from the file contents
+    bool load(const QString &filename);
+    //Text macro, one "joint u v" line per change
+    bool load_text(const QString &filename);
+    bool load_binary(const QString &filename);
+    bool write_binary(const QString &filename) const;
+    QString error_string() const;
+    void clear();
+    //joint must be below MAX_JOINTS
+    void push_back(unsigned joint, double u, double v);
+
+    std::size_t size() const;
+    const MacroLine &line(std::size_t i) const;
+
+    //Binary macros carry their own frame index, so this only changes text macros
+    void set_initial_lines(std::size_t count);
+    std::size_t initial_lines() const;
+    std::size_t frame_count() const;
+    //Lines [first, last) make up frame f
+    void frame_lines(std::size_t f, std::size_t &first, std::size_t &last) const;
+
+    //Full joint state every interval frames, so a seek replays at most interval frames
+    void build_keyframes(std::size_t interval = KEYFRAME_INTERVAL);
+    std::size_t keyframe_count() const;
+    std::size_t keyframe_joints() const;
+    std::size_t keyframe_frame(std::size_t k) const;
+    //keyframe_joints() (u, v) pairs
+    const double *keyframe_state(std::size_t k) const;
+    //Last keyframe at or before frame, false if there is none
+    bool find_keyframe(std::size_t frame, std::size_t &k) const;
+
+    static const std::size_t KEYFRAME_INTERVAL = 256;
+    static const std::size_t MAX_JOINTS = 1 << 20;
+
+protected:
+    //Either mOwned or the mapped file
+    const MacroLine *mLines;
+    std::size_t mCount;
+    //Only set for binary macros
+    const quint64 *mFrameStart;
+    std::size_t mFrameCount;
+
+    //Either the owned vectors or the mapped file
+    const quint64 *mKeyFrame;
+    const double *mKeyState;
+    std::size_t mKeyCount;
+    std::size_t mKeyJoints;
+
+    std::vector<MacroLine> mOwned;
+    std::vector<quint64> mOwnedKeyFrame;
+    std::vector<double> mOwnedKeyState;
+    QFile mFile;
+    uchar *mMap;
+
+    std::size_t mInitialLines;
+    QString mError;
+
+private:
+    Q_DISABLE_COPY(Macro)
+    std::size_t first_frame_lines() const;
+    void clear_keyframes();
+    void compute_keyframes(std::size_t interval, std::vector<quint64> &frames, std::vector<double> &states, std::size_t &joints) const;
+};
+
+#endif // MACRO_H
@@ -0,0 +1,170 @@
+//-------------------------------------------------------
+// Filename: macro_test.cpp
+//
+// Description: Checks that macro files naming impossible
+//              joints are rejected, and that seeking gives
+//              the same joints as replaying from the start.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <cstdio>
+#include <random>
+#include <string>
+#include "macro.h"
+#include "macroplayer.h"
+#include "testing.h"
+
+namespace {
+
+void write_text(const char *filename, const std::string &text)
+{
+    std::FILE *file = std::fopen(filename, "wb");
+    std::fwrite(text.data(), 1, text.size(), file);
+    std::fclose(file);
+}
+
+void test_joint_limit()
+{
+    const char *text = "macro_test.txt";
+    const char *binary = "macro_test.srm";
+
+    //A corrupt index would make every keyframe tens of gigabytes
+    write_text(text, "0 0 0\n1 .5 0\n4000000000 0 0\n");
+    Macro macro;
+    CHECK(!macro.load(text));
+    CHECK(!macro.error_string().isEmpty());
+    CHECK(macro.size() == 0);
+
+    write_text(text, "0 0 0\n1 .5 0\n" + std::to_string(Macro::MAX_JOINTS) + " 0 0\n");
+    CHECK(!macro.load(text));
+
+    write_text(text, "0 0 0\n1 .5 0\n" + std::to_string(Macro::MAX_JOINTS-1) + " 0 0\n");
+    CHECK(macro.load(text));
+    macro.build_keyframes();
+    CHECK(macro.keyframe_joints() == Macro::MAX_JOINTS);
+
+    //The same check applies to binary files, whose lines are read in place
+    write_text(text, "0 0 0\n1 .5 0\n2 0 .25\n");
+    CHECK(macro.load(text));
+    CHECK(macro.write_binary(binary));
+    Macro mapped;
+    CHECK(mapped.load(binary));
+    CHECK(mapped.size() == 3);
+    mapped.clear();
+
+    std::FILE *file = std::fopen(binary, "r+b");
+    quint32 joint = 4000000000u;
+    //The third line's joint, after the 72 byte header
+    std::fseek(file, 72 + 2*sizeof(MacroLine), SEEK_SET);
+    std::fwrite(&joint, sizeof(joint), 1, file);
+    std::fclose(file);
+    CHECK(!mapped.load(binary));
+    CHECK(!mapped.error_string().isEmpty());
+
+    std::remove(text);
+    std::remove(binary);
+}
+
+//Joints with a starting pose of their own, so a joint the macro has not
+//set yet is told apart from one it set to zero
+void make_joints(JointStore &joints)
+{
+    joints.clear();
+    for (int i = 0; i < 6; i++)
+    {
+        joints.push_back(i, 5, 1);
+        joints.set_axis(i, .1*i, -.05*i);
+    }
+}
+
+//The reference: frames [0, frame] applied in order to the starting pose
+void replay(const Macro &macro, std::size_t frame, JointStore &joints)
+{
+    make_joints(joints);
+    for (std::size_t f = 0; f <= frame; f++)
+    {
+        std::size_t first, last;
+        macro.frame_lines(f, first, last);
+        for (std::size_t k = first; k < last; k++)
+        {
+            const MacroLine &line = macro.line(k);
+            if (line.joint < joints.size())
+                joints.set_axis(line.joint, line.u, line.v);
+        }
+    }
+}
+
+bool same_axes(const JointStore &a, const JointStore &b)
+{
+    for (std::size_t i = 0; i < a.size(); i++)
+    {
+        double au, av, bu, bv;
+        a.get_axis(i, au, av);
+        b.get_axis(i, bu, bv);
+        if (au != bu || av != bv)
+            return false;
+    }
+    return a.size() == b.size();
+}
+
+void test_seek()
+{
+    //Frame 0 sets joint 0 only. Joints 1-3 are set along the way, joint 3
+    //only late, joints 4 and 5 never, and joint 7 is not in the store.
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<double> bend(-1.6, 1.6);
+    Macro macro;
+    macro.push_back(0, .5, .5);
+    for (int k = 0; k < 1000; k++)
+    {
+        unsigned joint = k < 600 ? k%3 : k%4;
+        if (k == 700)
+            joint = 7;
+        macro.push_back(joint, bend(rng), bend(rng));
+    }
+    macro.set_initial_lines(1);
+    macro.build_keyframes(32);
+    CHECK(macro.frame_count() == 1001);
+    CHECK(macro.keyframe_count() > 1);
+
+    JointStore joints, expected;
+    make_joints(joints);
+    MacroPlayer player;
+    player.set_macro(&macro, &joints);
+
+    //Forward, backward, across keyframes, onto keyframes and back to the start
+    std::vector<std::size_t> frames;
+    static const std::size_t fixed[] = {500, 10, 999, 0, 640, 639, 64, 1000, 31, 32, 33, 700, 0, 2000};
+    frames.assign(fixed, fixed + sizeof(fixed)/sizeof(fixed[0]));
+    std::uniform_int_distribution<std::size_t> any(0, 1000);
+    for (int k = 0; k < 200; k++)
+        frames.push_back(any(rng));
+
+    for (std::size_t k = 0; k < frames.size(); k++)
+    {
+        player.seek(frames[k]);
+        std::size_t frame = std::min<std::size_t>(frames[k], 1000);
+        CHECK(player.frame() == frame+1);
+        replay(macro, frame, expected);
+        if (!CHECK(same_axes(joints, expected)))
+            std::fprintf(stderr, "seek to %zu after %zu\n", frame, k ? frames[k-1] : 0);
+    }
+
+    //Playing again from the start also begins at the starting pose
+    player.seek(900);
+    player.stop();
+    player.seek(0);
+    replay(macro, 0, expected);
+    CHECK(same_axes(joints, expected));
+}
+
+}
+
+int main()
+{
+    test_joint_limit();
+    test_seek();
+    return test_result();
+}
@@ -0,0 +1,277 @@
+//-------------------------------------------------------
+// Filename: macroplayer.cpp
+//
+// Description: Fixed timestep macro playback with pause,
+//              seek, speed control and frame dropping.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "macroplayer.h"
+#include "trace.h"
+#include <algorithm>
+
+MacroPlayer::MacroPlayer(QObject *parent):
+    QObject(parent),
+    mMacro{0},
+    mJoints{0},
+    mStep{50},
+    mSpeed{1},
+    mPlaying{false},
+    mFrame{0},
+    mClockStart{0},
+    mDrawn{0},
+    mDropped{0}
+{
+    mTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mTimer, SIGNAL(timeout()), this, SLOT(tick()));
+}
+
+void MacroPlayer::set_macro(const Macro *macro, JointStore *joints)
+{
+    stop();
+    mMacro = macro;
+    mJoints = joints;
+    mFrame = 0;
+    clear_changed();
+
+    mStart.clear();
+    for (std::size_t j = 0; mJoints && j < mJoints->size(); j++)
+    {
+        double u, v;
+        mJoints->get_axis(j, u, v);
+        mStart.push_back(u);
+        mStart.push_back(v);
+    }
+}
+
+void MacroPlayer::set_step(int milliseconds)
+{
+    double time = playback_time();
+    mStep = std::max(1, milliseconds);
+    restart_clock(time);
+    mTimer.setInterval(std::max(1, int(mStep/mSpeed)));
+}
+
+int MacroPlayer::step() const
+{
+    return mStep;
+}
+
+void MacroPlayer::set_speed(double speed)
+{
+    if (speed <= 0)
+        return;
+    double time = playback_time();
+    mSpeed = speed;
+    restart_clock(time);
+    mTimer.setInterval(std::max(1, int(mStep/mSpeed)));
+}
+
+double MacroPlayer::speed() const
+{
+    return mSpeed;
+}
+
+bool MacroPlayer::is_playing() const
+{
+    return mPlaying;
+}
+
+std::size_t MacroPlayer::frame() const
+{
+    return mFrame;
+}
+
+std::size_t MacroPlayer::frame_count() const
+{
+    return mMacro ? mMacro->frame_count() : 0;
+}
+
+double MacroPlayer::target_rate() const
+{
+    return 1000.0*mSpeed/mStep;
+}
+
+double MacroPlayer::achieved_rate() const
+{
+    qint64 ms = mRateClock.isValid() ? mRateClock.elapsed() : 0;
+    if (ms <= 0)
+        return 0;
+    return 1000.0*mDrawn/ms;
+}
+
+std::size_t MacroPlayer::dropped_frames() const
+{
+    return mDropped;
+}
+
+const std::vector<std::size_t> &MacroPlayer::changed_joints() const
+{
+    return mChanged;
+}
+
+void MacroPlayer::play()
+{
+    if (!mMacro || !mJoints || mPlaying)
+        return;
+    if (mFrame >= frame_count())
+        mFrame = 0;
+
+    mPlaying = true;
+    mDrawn = 0;
+    mDropped = 0;
+    mRateClock.start();
+    //Frame mFrame is due now
+    restart_clock(mFrame*double(mStep));
+    mTimer.start(std::max(1, int(mStep/mSpeed)));
+    tick();
+}
+
+void MacroPlayer::pause()
+{
+    if (!mPlaying)
+        return;
+    mTimer.stop();
+    mClockStart = playback_time();
+    mPlaying = false;
+}
+
+void MacroPlayer::stop()
+{
+    pause();
+    mFrame = 0;
+}
+
+void MacroPlayer::seek(std::size_t frame)
+{
+    TRACE_SCOPE("macro_seek");
+    if (!mMacro || !mJoints || frame_count() == 0)
+        return;
+    frame = std::min(frame, frame_count()-1);
+
+    //Lines only set one joint, so jump to the nearest keyframe at or before
+    //the target unless the frames already applied get there sooner. Going
+    //back to frame 0 restores the starting state when frame 0 is applied.
+    std::size_t k;
+    if (mMacro->find_keyframe(frame, k) && (frame < mFrame || mMacro->keyframe_frame(k) >= mFrame))
+        restore_keyframe(k);
+    else if (frame < mFrame)
+        mFrame = 0;
+
+    while (mFrame <= frame)
+        apply_frame(mFrame++);
+    restart_clock(mFrame*double(mStep));
+    emit frame_ready();
+    clear_changed();
+}
+
+void MacroPlayer::seek_time(double milliseconds)
+{
+    seek(std::size_t(std::max(0.0, milliseconds)/mStep));
+}
+
+void MacroPlayer::tick()
+{
+    TRACE_SCOPE("macro_tick");
+    std::size_t count = frame_count();
+    //Every frame whose time has come, drawn once at the end
+    std::size_t due = std::min(count, std::size_t(playback_time()/mStep) + 1);
+    if (due > mFrame)
+    {
+        mDropped += due - mFrame - 1;
+        while (mFrame < due)
+            apply_frame(mFrame++);
+        mDrawn++;
+        emit frame_ready();
+        clear_changed();
+    }
+
+    if (mFrame >= count)
+    {
+        pause();
+        emit finished();
+    }
+}
+
+double MacroPlayer::playback_time() const
+{
+    if (!mPlaying || !mClock.isValid())
+        return mClockStart;
+    return mClockStart + mClock.nsecsElapsed()*1e-6*mSpeed;
+}
+
+void MacroPlayer::restart_clock(double time)
+{
+    mClockStart = time;
+    mClock.start();
+}
+
+void MacroPlayer::apply_frame(std::size_t f)
+{
+    //Replaying from the start must not keep anything later frames set
+    if (f == 0)
+        restore_start();
+
+    std::size_t first, last;
+    mMacro->frame_lines(f, first, last);
+    for (std::size_t k = first; k < last; k++)
+    {
+        const MacroLine &line = mMacro->line(k);
+        //Macros recorded on a longer chain may name joints that are not here
+        if (line.joint >= mJoints->size())
+            continue;
+        set_joint(line.joint, line.u, line.v);
+        emit line_applied(line.joint, line.u, line.v);
+    }
+}
+
+void MacroPlayer::restore_start()
+{
+    std::size_t joints = std::min(mStart.size()/2, mJoints->size());
+    for (std::size_t j = 0; j < joints; j++)
+        restore_joint(j, mStart[2*j], mStart[2*j+1]);
+}
+
+void MacroPlayer::restore_keyframe(std::size_t k)
+{
+    //NaN marks a joint the macro has not set yet, which still has its starting value
+    restore_start();
+    const double *state = mMacro->keyframe_state(k);
+    std::size_t joints = std::min(mMacro->keyframe_joints(), mJoints->size());
+    for (std::size_t j = 0; j < joints; j++)
+    {
+        if (state[2*j] == state[2*j])
+            restore_joint(j, state[2*j], state[2*j+1]);
+    }
+    mFrame = mMacro->keyframe_frame(k)+1;
+}
+
+void MacroPlayer::restore_joint(std::size_t joint, double u, double v)
+{
+    //Only joints that actually move are redrawn
+    double old_u, old_v;
+    mJoints->get_axis(joint, old_u, old_v);
+    if (old_u != u || old_v != v)
+        set_joint(joint, u, v);
+}
+
+void MacroPlayer::set_joint(std::size_t joint, double u, double v)
+{
+    mJoints->set_axis(joint, u, v);
+    if (mChangedFlag.size() < mJoints->size())
+        mChangedFlag.resize(mJoints->size(), false);
+    if (!mChangedFlag[joint])
+    {
+        mChangedFlag[joint] = true;
+        mChanged.push_back(joint);
+    }
+}
+
+void MacroPlayer::clear_changed()
+{
+    for (std::size_t k = 0; k < mChanged.size(); k++)
+        mChangedFlag[mChanged[k]] = false;
+    mChanged.clear();
+}
@@ -0,0 +1,104 @@
+//-------------------------------------------------------
+// Filename: macroplayer.h
+//
+// Description: Fixed timestep macro playback with pause,
+//              seek, speed control and frame dropping.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef MACROPLAYER_H
+#define MACROPLAYER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <vector>
+#include "macro.h"
+#include "jointstore.h"
+
+//Frame f of the macro is due at f*step/speed milliseconds of playback.
+//Each tick applies every frame that is due to the joint store and then
+//asks for a single redraw, so a slow renderer drops frames instead of
+//falling behind the clock.
+class MacroPlayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MacroPlayer(QObject *parent = 0);
+    //The joints' current (u, v) is the state before frame 0, restored
+    //whenever playback goes back to the start
+    void set_macro(const Macro *macro, JointStore *joints);
+
+    void set_step(int milliseconds);
+    int step() const;
+    void set_speed(double speed);
+    double speed() const;
+
+    bool is_playing() const;
+    //Frames [0, frame()) have been applied
+    std::size_t frame() const;
+    std::size_t frame_count() const;
+
+    //Frames per second the clock asks for, and frames actually drawn
+    double target_rate() const;
+    double achieved_rate() const;
+    std::size_t dropped_frames() const;
+
+    //Joints set since the last frame_ready, in the order they were first set
+    const std::vector<std::size_t> &changed_joints() const;
+
+public slots:
+    void play();
+    void pause();
+    void stop();
+    //Restores the nearest keyframe, then replays at most a keyframe interval of frames
+    void seek(std::size_t frame);
+    void seek_time(double milliseconds);
+
+signals:
+    void line_applied(int joint, double u, double v);
+    //Emitted once per tick after its frames have been applied
+    void frame_ready();
+    void finished();
+
+private slots:
+    void tick();
+
+private:
+    double playback_time() const;
+    void restart_clock(double time);
+    void apply_frame(std::size_t f);
+    void restore_start();
+    void restore_keyframe(std::size_t k);
+    void restore_joint(std::size_t joint, double u, double v);
+    void set_joint(std::size_t joint, double u, double v);
+    void clear_changed();
+
+    const Macro *mMacro;
+    JointStore *mJoints;
+    QTimer mTimer;
+    QElapsedTimer mClock;
+
+    int mStep;
+    double mSpeed;
+    bool mPlaying;
+    std::size_t mFrame;
+    //(u, v) of every joint before frame 0
+    std::vector<double> mStart;
+
+    //Playback time when mClock was last restarted
+    double mClockStart;
+
+    //Frames drawn and dropped since play() for the rate report
+    QElapsedTimer mRateClock;
+    std::size_t mDrawn;
+    std::size_t mDropped;
+
+    std::vector<std::size_t> mChanged;
+    std::vector<bool> mChangedFlag;
+};
+
+#endif // MACROPLAYER_H
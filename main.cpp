@@ -10,12 +10,16 @@
 
 #include "mainwindow.h"
 #include <QApplication>
+#include "trace.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    trace_start_from_environment();
     MainWindow w;
     w.showMaximized();
     w.show();
-    return a.exec();
+    int result = a.exec();
+    trace_finish_from_environment();
+    return result;
 }
@@ -8,12 +8,13 @@
 // Creation Date: 11/9/2017
 //-------------------------------------------------------
 #include "mainwindow.h"
+#include "trace.h"
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QCloseEvent>
 #include "ui_mainwindow.h"
 #include <QTextStream>
-#include <QTime>
+#include <QInputDialog>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -31,17 +32,28 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->actionAdd_Shape,SIGNAL(triggered(bool)),SLOT(actionAdd_Shape_triggered(bool)));
     connect(ui->actionRemove_Shape,SIGNAL(triggered(bool)),SLOT(actionRemove_Shape_triggered(bool)));
     connect(ui->actionStarting_Position,SIGNAL(triggered(bool)),SLOT(actionStarting_Position_triggered(bool)));
+    connect(ui->graphicsView,SIGNAL(collisions_checked(int,int,double,double)),SLOT(collisions_checked(int,int,double,double)));
+    connect(&mPlayer,SIGNAL(line_applied(int,double,double)),SLOT(macro_line_applied(int,double,double)));
+    connect(&mPlayer,SIGNAL(frame_ready()),SLOT(macro_frame_ready()));
+    connect(&mPlayer,SIGNAL(finished()),SLOT(macro_finished()));
 
     ui->JointsList->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->JointsList, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(showContextMenu(QPoint)));
 
     //Makes sure we get valid inputs for U, V, and Size
     ui->lineEdit_Size->setValidator(new QDoubleValidator(.5, 100, 10, this));
-    ui->lineEdit_U->setValidator(new QDoubleValidator(-1.6,1.6,10,this));
-    ui->lineEdit_V->setValidator(new QDoubleValidator(-1.6,1.6,10,this));
+    ui->lineEdit_U->setValidator(new QDoubleValidator(-AXIS_LIMIT,AXIS_LIMIT,10,this));
+    ui->lineEdit_V->setValidator(new QDoubleValidator(-AXIS_LIMIT,AXIS_LIMIT,10,this));
 
     //initialize some parameters
     ui->actionRemove_Shape->setEnabled(false);
+    ui->actionRecord_Trace->setChecked(trace_enabled());
+    mRateLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(mRateLabel);
+    mStateLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(mStateLabel);
+    mStateLabel->hide();
+    update_macro_actions();
 }
 
 MainWindow::~MainWindow()
@@ -87,14 +99,15 @@ void MainWindow::actionView_Floor_triggered(bool)
     {
         ui->graphicsView->view_floor(true);
         ui->actionView_Floor->setText("Hide Floor");
-        ui->graphicsView->update();
+        ui->graphicsView->request_redraw();
     }
     else
     {
         ui->actionView_Floor->setText("View Floor");
         ui->graphicsView->view_floor(false);
-        ui->graphicsView->update();
+        ui->graphicsView->request_redraw();
     }
+    update_state_label();
 }
 
 void MainWindow::actionAdd_Shape_triggered(bool)
@@ -106,16 +119,15 @@ void MainWindow::actionAdd_Shape_triggered(bool)
 
 void MainWindow::actionRemove_Shape_triggered(bool)
 {
-    int k{0};
-    if (ui->actionView_Floor->text()=="Hide Floor")
-        k++;
-    ui->graphicsView->removeShape(k);
+    ui->graphicsView->removeShape();
+    ui->graphicsView->check_collisions();
+    update_state_label();
     mNumShapes--;
     if (mNumShapes == 0)
     {
         ui->actionRemove_Shape->setEnabled(false);
     }
-    ui->graphicsView->update();
+    ui->graphicsView->request_redraw();
 }
 
 void MainWindow::actionStarting_Position_triggered(bool)
@@ -128,11 +140,11 @@ void MainWindow::actionStarting_Position_triggered(bool)
 
 void MainWindow::starting_pose(osg::MatrixTransform *transform)
 {
-    ui->graphicsView->set_starting_pose(transform);
-    if (mList.size()>0)
+    ui->graphicsView->set_starting_pose(transform,mJoints);
+    if (mJoints.size()>0)
     {
-        ui->graphicsView->change_joint_config(0,mList);
-        ui->graphicsView->update();
+        ui->graphicsView->change_joint_config(0,mJoints);
+        ui->graphicsView->request_redraw();
     }
     show_matrix();
 }
@@ -140,17 +152,29 @@ void MainWindow::starting_pose(osg::MatrixTransform *transform)
 void MainWindow::shapecreated(QString shape, osg::Vec3 size, osg::Vec3 translation, osg::Vec3 rotation, osg::Vec3 color)
 {
     ui->graphicsView->create_shape(shape,size,translation,rotation,color);
+    ui->graphicsView->check_collisions();
+    update_state_label();
     ui->actionRemove_Shape->setEnabled(true);
     mNumShapes++;
-    ui->graphicsView->update();
+    ui->graphicsView->request_redraw();
+}
+
+void MainWindow::collisions_checked(int contacts, int self_contacts, double max_depth, double query_ms)
+{
+    if (contacts == 0 && self_contacts == 0)
+        ui->statusbar->showMessage(QString("No collisions (%1 ms)").arg(query_ms,0,'f',3));
+    else
+        ui->statusbar->showMessage(QString("%1 obstacle contacts, %2 self contacts, max depth %3 (%4 ms)")
+                                   .arg(contacts).arg(self_contacts).arg(max_depth,0,'f',3).arg(query_ms,0,'f',3));
 }
 
 void MainWindow::actionOpen_triggered(bool)
 {
+    TRACE_SCOPE("open_file");
     // tr sets the title for the open window, "C://" sets which directory is the default
     QString filename = QFileDialog::getOpenFileName(this, tr("Open File"), "C://","XML files (*.xml);;All files (*.*)");
 
-    if(!mList.empty())
+    if(!mJoints.empty())
     {
         QMessageBox msgBox;
         int ret = QMessageBox::warning(this, tr("Open New File"), tr("By opening this file, you will lose any unsaved changes.\n"
@@ -174,7 +198,8 @@ void MainWindow::actionOpen_triggered(bool)
         }
     }
 
-    mList.clear();
+    mPlayer.stop();
+    mJoints.clear();
     ui->graphicsView->reset();
     mRow_edit = -1;
 
@@ -184,7 +209,6 @@ void MainWindow::actionOpen_triggered(bool)
     if (ui->actionView_Floor->text() != "View Floor")
         ui->actionView_Floor->setText("View Floor");
 
-    std::list<Joint*> linkedlist{};
     QFile file(filename);
     if(!file.open(QFile::ReadOnly | QFile::Text))
     {
@@ -194,24 +218,19 @@ void MainWindow::actionOpen_triggered(bool)
     }
 
     //Reads in the file
-    XmlReader joint_reader(linkedlist);
+    XmlReader joint_reader(mJoints);
 
     if (!joint_reader.read(&file))
     {
+        mJoints.clear();
         QString error{"Parse error in file\n"};
         error += joint_reader.errorString();
         QMessageBox::warning(this, "File Read Error", error);
         return;
     }
 
-    //Updates the list
-    for (std::list<Joint*>::iterator it= linkedlist.begin(); it != linkedlist.end(); it++)
-    {
-        mList.push_back(*it);
-    }
-
     //Updates the GUI
-    ui->graphicsView->open_arm(mList);
+    ui->graphicsView->open_arm(mJoints);
     mName = filename;
     mSave=true;
     update_list();
@@ -240,7 +259,7 @@ void MainWindow::actionSave_triggered(bool)
     //Write to the specified file
     else
     {
-        XmlWriter joint_writer(mList);
+        XmlWriter joint_writer(mJoints);
         joint_writer.write(&file);
         mSave = true;
     }
@@ -267,14 +286,21 @@ void MainWindow::actionHide_Axis_triggered(bool)
     {
         ui->graphicsView->drawAxis(true);
         ui->actionHide_Axis->setText("Hide Axis");
-        ui->graphicsView->update();
+        ui->graphicsView->request_redraw();
     }
     else
     {
         ui->actionHide_Axis->setText("View Axis");
         ui->graphicsView->drawAxis(false);
-        ui->graphicsView->update();
+        ui->graphicsView->request_redraw();
     }
+    update_state_label();
+}
+
+void MainWindow::on_actionCount_State_Sets_triggered(bool checked)
+{
+    mStateLabel->setVisible(checked);
+    update_state_label();
 }
 
 void MainWindow::showContextMenu(const QPoint &pos)
@@ -292,54 +318,58 @@ void MainWindow::showContextMenu(const QPoint &pos)
 
 void MainWindow::update_list()
 {
-    int i = 1;
     ui->JointsList->clear();
-    for (std::list<Joint*>::iterator it= mList.begin(); it != mList.end(); it++)
+    for (std::size_t i = 1; i <= mJoints.size(); i++)
     {
         QString string{"Joint "};
         string.append(QString::number(i));
         ui->JointsList->addItem(string);
-        i++;
     }
     //Colors the row that we are editing
-    if (mRow_edit>=0 && mList.size()>0)
+    if (mRow_edit>=0 && mJoints.size()>0)
         ui->JointsList->item(mRow_edit)->setBackgroundColor(Qt::lightGray);
+    update_state_label();
+}
+
+void MainWindow::update_state_label()
+{
+    //Counting walks the whole scene graph, so it only runs while the count is shown
+    if (!ui->actionCount_State_Sets->isChecked())
+        return;
+    mStateLabel->setText(QString("%1 state sets").arg(ui->graphicsView->unique_states()));
 }
 
 void MainWindow::on_Add_Joint_clicked()
 {
     static int id{0};
     id++;
-    Joint* j = new Joint(id,5,1);
-    j->set_color(0,0,0);
-    mList.push_back(j);
-    update_list();
+    mJoints.push_back(id,5,1);
+    mJoints.set_color(mJoints.size()-1,0,0,0);
     mSave = false;
-    ui->graphicsView->create_arm(mList);
-    ui->graphicsView->update();
+    ui->graphicsView->create_arm(mJoints);
+    update_list();
+    ui->graphicsView->request_redraw();
 }
 
 void MainWindow::deleteItem()
 {
-    if (mList.size()<=0)
+    if (mJoints.size()<=0)
     {
-        mList.clear();
+        mJoints.clear();
         mRow_edit = -1;
     }
-    else if (mList.size()==1)
+    else if (mJoints.size()==1)
     {
-        ui->graphicsView->erase_joint(0,mList);
-        mList.clear();
+        mJoints.clear();
+        ui->graphicsView->erase_joint(0,mJoints);
         mRow_edit = -1;
     }
     else
     {
         //Find selected item in the list and deletes it
-        std::list<Joint*>::iterator it= mList.begin();
         int del = ui->JointsList->currentRow();
-        std::advance(it,del);
-        ui->graphicsView->erase_joint(del,mList);
-        mList.remove(*it);
+        mJoints.erase(del);
+        ui->graphicsView->erase_joint(del,mJoints);
         if (del==mRow_edit)
             mRow_edit = -1;
         else if (del<mRow_edit)
@@ -347,8 +377,8 @@ void MainWindow::deleteItem()
     }
     //remove it from the display list
     update_list();
-    ui->graphicsView->update();
-    if (mList.size()>0)
+    ui->graphicsView->request_redraw();
+    if (mJoints.size()>0)
     {
         int k = mRow_edit;
         mRow_edit = 0;
@@ -365,14 +395,12 @@ void MainWindow::on_JointsList_itemDoubleClicked(QListWidgetItem *item)
         ui->graphicsView->select_joint(mRow_edit,false);
     mRow_edit = ui->JointsList->currentRow();
     ui->graphicsView->select_joint(mRow_edit,true);
-    ui->graphicsView->update();
+    ui->graphicsView->request_redraw();
 
-    std::list<Joint*>::iterator it= mList.begin();
-    std::advance(it,mRow_edit);
     double h,r,u,v,red,green,blue;
-    (*it)->get_size(h,r);
-    (*it)->get_axis(u,v);
-    (*it)->get_color(red,green,blue);
+    mJoints.get_size(mRow_edit,h,r);
+    mJoints.get_axis(mRow_edit,u,v);
+    mJoints.get_color(mRow_edit,red,green,blue);
 
     // Update all the sliders and text boxes
     ui->lineEdit_Size->setText(QString::number(h));
@@ -396,7 +424,7 @@ void MainWindow::show_matrix()
         return;
     }
 
-    osg::MatrixTransform* matrix = ui->graphicsView->output_matrix(mRow_edit,mList);
+    osg::MatrixTransform* matrix = ui->graphicsView->output_matrix(mRow_edit,mJoints);
     osg::Matrix m = matrix->getMatrix();
     QString string;
 
@@ -427,15 +455,13 @@ void MainWindow::on_lineEdit_V_editingFinished()
 
 void MainWindow::on_lineEdit_Size_editingFinished()
 {
-    if (mRow_edit>=0 && mRow_edit<= mList.size())
+    if (mRow_edit>=0 && mRow_edit < mJoints.size())
     {
-        std::list<Joint*>::iterator it= mList.begin();
-        std::advance(it,mRow_edit);
         double h, r;
-        (*it)->get_size(h,r);
-        ui->graphicsView->update_joint_size((*it), ui->lineEdit_Size->text().toDouble(),r);
-        ui->graphicsView->change_joint_config(mRow_edit,mList);
-        ui->graphicsView->update();
+        mJoints.get_size(mRow_edit,h,r);
+        ui->graphicsView->update_joint_size(mRow_edit, mJoints, ui->lineEdit_Size->text().toDouble(),r);
+        ui->graphicsView->change_joint_config(mRow_edit,mJoints);
+        ui->graphicsView->request_redraw();
         mSave = false;
     }
     show_matrix();
@@ -443,7 +469,7 @@ void MainWindow::on_lineEdit_Size_editingFinished()
 
 void MainWindow::update_color_label()
 {
-    if (mRow_edit>=0 && mRow_edit<= mList.size())
+    if (mRow_edit>=0 && mRow_edit < mJoints.size())
     {
         mSave = false;
     }
@@ -451,13 +477,11 @@ void MainWindow::update_color_label()
     double g = ui->greenSlider->value();
     double b = ui->blueSlider->value();
     ui->colorLabel->setStyleSheet(QString("background-color: rgb(%1, %2, %3);").arg(r).arg(g).arg(b));
-    if (mRow_edit>=0 && mRow_edit<= mList.size())
+    if (mRow_edit>=0 && mRow_edit < mJoints.size())
     {
-        std::list<Joint*>::iterator it= mList.begin();
-        std::advance(it,mRow_edit);
-        (*it)->set_color(r,g,b);
-        ui->graphicsView->joint_color( mRow_edit,(*it));
-        ui->graphicsView->update();
+        mJoints.set_color(mRow_edit,r,g,b);
+        ui->graphicsView->joint_color( mRow_edit,mJoints);
+        ui->graphicsView->request_redraw();
     }
 }
 
@@ -478,15 +502,13 @@ void MainWindow::on_blueSlider_valueChanged(int value)
 
 void MainWindow::update_UV()
 {
-    if (mRow_edit>=0 && mRow_edit<=mList.size())
+    if (mRow_edit>=0 && mRow_edit < mJoints.size())
     {
-        std::list<Joint*>::iterator it= mList.begin();
-        std::advance(it,mRow_edit);
         double u = ui->lineEdit_U->text().toDouble();
         double v = ui->lineEdit_V->text().toDouble();
-        (*it)->set_axis(u,v);
-        ui->graphicsView->change_joint_config(mRow_edit,mList);
-        ui->graphicsView->update();
+        mJoints.set_axis(mRow_edit,u,v);
+        ui->graphicsView->change_joint_config(mRow_edit,mJoints);
+        ui->graphicsView->request_redraw();
         show_matrix();
         mSave = false;
         if(mRecordMacro == true)
@@ -514,7 +536,7 @@ void MainWindow::on_v_slider_valueChanged(int value)
 void MainWindow::on_actionRecord_Macro_triggered(bool checked)
 {
     mRecordMacro = checked;
-    if(mRecordMacro == false && mMacro.size() != mList.size())
+    if(mRecordMacro == false && mMacro.size() != mJoints.size())
     {
         QMessageBox msgBox;
         int ret = QMessageBox::warning(this, tr("Unsaved Macro"), tr("Finished recording macro.\n"
@@ -530,13 +552,11 @@ void MainWindow::on_actionRecord_Macro_triggered(bool checked)
     }
     else
     {
-        int i = 0;
-        for(auto it = mList.begin(); it != mList.end(); it++)
+        for(std::size_t i = 0; i < mJoints.size(); i++)
         {
             double u, v;
-            (*it)->get_axis(u,v);
+            mJoints.get_axis(i,u,v);
             mMacro.push_back(QString("%1 %2 %3").arg(i).arg(u).arg(v));
-            i++;
         }
 
     }
@@ -566,55 +586,169 @@ void MainWindow::save_macro()
 
 void MainWindow::on_actionRun_Macro_triggered(bool checked)
 {
-    int line_count = 0;
-    QString filename = QFileDialog::getOpenFileName(this, tr("Open File"), "C://","Text files (*.txt);");
-    QFile inputFile(filename);
-    if (inputFile.open(QIODevice::ReadOnly))
-    {
-       QTextStream in(&inputFile);
-       while (!in.atEnd())
-       {
-          QStringList line = in.readLine().split(" ");
-          if(line.size() != 3)
-          {
-              ui->outputWindow->setText(QString("Invalid Macro Line: %1").arg(line_count));
-              return;
-          }
-          int joint = (line[0]).toInt();
-          double u = (line[1]).toDouble();
-          double v = (line[2]).toDouble();
-          auto it = mList.begin();
-          std::advance(it,joint);
-          (*it)->set_axis(u, v);
-          ui->graphicsView->change_joint_config(joint,mList);
-          ui->graphicsView->update();
-          if(mRecordMacro == true)
-          {
-              //store new U and V in mMacro
-              mMacro.push_back(QString("%1 %2 %3").arg(mRow_edit).arg(u).arg(v));
-          }
-          if(line_count >= mList.size())
-          {
-              //delay
-              QTime dieTime= QTime::currentTime().addMSecs(50);
-              while (QTime::currentTime() < dieTime)
-              {
-                  QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
-              }
-          }
-          line_count++;
-       }
-       inputFile.close();
+    QString filename = QFileDialog::getOpenFileName(this, tr("Open File"), "C://","Macros (*.txt *.srm);;All files (*.*)");
+    if (filename.isEmpty())
+        return;
+
+    mPlayer.stop();
+    if (!mPlayback.load(filename))
+    {
+        ui->outputWindow->setText(mPlayback.error_string());
+        mPlayer.set_macro(0, 0);
+        update_macro_actions();
+        return;
+    }
+    //The first line for every joint is the starting state, drawn as one frame
+    mPlayback.set_initial_lines(mJoints.size());
+    //Text and version 1 macros have no stored keyframes, so seeking needs them built here
+    if (mPlayback.keyframe_count() == 0)
+        mPlayback.build_keyframes();
+    mPlayer.set_macro(&mPlayback, &mJoints);
+    mPlayer.play();
+    update_macro_actions();
+}
+
+void MainWindow::on_actionConvert_Macro_triggered(bool checked)
+{
+    QString input = QFileDialog::getOpenFileName(this, tr("Open File"), "C://","Text files (*.txt)");
+    if (input.isEmpty())
+        return;
+    QString output = QFileDialog::getSaveFileName(this, tr("Save As"), "C://", "Binary Macros (*.srm)");
+    if (output.isEmpty())
+        return;
+
+    Macro macro;
+    if (!macro.load_text(input))
+    {
+        ui->outputWindow->setText(macro.error_string());
+        return;
+    }
+    if (!macro.write_binary(output))
+    {
+        QMessageBox::warning(this, "Error", "Cannot Write File");
+        return;
+    }
+    ui->outputWindow->setText(QString("Converted %1 lines in %2 frames").arg(macro.size()).arg(macro.frame_count()));
+}
+
+void MainWindow::on_actionRecord_Trace_triggered(bool checked)
+{
+    if (checked)
+    {
+        trace_clear();
+        trace_set_enabled(true);
+        return;
+    }
+
+    trace_set_enabled(false);
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Trace"), "C://", "Chrome traces (*.json)");
+    if (filename.isEmpty())
+        return;
+    if (!trace_write(filename.toStdString()))
+    {
+        QMessageBox::warning(this, "Error", "Cannot Write File");
+        return;
+    }
+    ui->outputWindow->setText(QString("Wrote %1 spans, %2 dropped").arg(trace_event_count()).arg(trace_dropped_count()));
+}
+
+void MainWindow::on_actionRecord_Render_Stats_triggered(bool checked)
+{
+    RenderStats &stats = ui->graphicsView->render_stats();
+    if (checked)
+    {
+        stats.clear();
+        stats.set_recording(true);
+        ui->graphicsView->request_redraw();
+        return;
     }
+
+    stats.set_recording(false);
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Render Stats"), "C://", "CSV files (*.csv)");
+    if (filename.isEmpty())
+        return;
+    //The percentile summary goes next to the per-frame file
+    QString summary = filename;
+    if (summary.endsWith(".csv", Qt::CaseInsensitive))
+        summary.chop(4);
+    summary += "_summary.csv";
+    if (!stats.write_csv(filename) || !stats.write_summary_csv(summary))
+    {
+        QMessageBox::warning(this, "Error", "Cannot Write File");
+        return;
+    }
+    ui->outputWindow->setText(QString("%1 frames, frame time p50 %2 ms, p95 %3 ms, p99 %4 ms")
+                              .arg(stats.size())
+                              .arg(stats.percentile(STAT_FRAME, 50), 0, 'f', 2)
+                              .arg(stats.percentile(STAT_FRAME, 95), 0, 'f', 2)
+                              .arg(stats.percentile(STAT_FRAME, 99), 0, 'f', 2));
+}
+
+void MainWindow::on_actionPause_Macro_triggered(bool checked)
+{
+    if (checked)
+        mPlayer.pause();
+    else
+        mPlayer.play();
+}
+
+void MainWindow::on_actionSeek_Macro_triggered(bool checked)
+{
+    if (mPlayer.frame_count() == 0 || mPlayer.frame() == 0)
+        return;
+    bool ok;
+    int frame = QInputDialog::getInt(this, tr("Seek Macro"), tr("Frame:"), int(mPlayer.frame())-1,
+                                     0, mPlayer.frame_count()-1, 1, &ok);
+    if (ok)
+        mPlayer.seek(frame);
+}
+
+void MainWindow::on_actionMacro_Speed_triggered(bool checked)
+{
+    bool ok;
+    double speed = QInputDialog::getDouble(this, tr("Macro Speed"), tr("Speed multiplier:"), mPlayer.speed(), .01, 100, 2, &ok);
+    if (ok)
+        mPlayer.set_speed(speed);
+}
+
+void MainWindow::macro_line_applied(int joint, double u, double v)
+{
+    if(mRecordMacro == true)
+    {
+        //store new U and V in mMacro
+        mMacro.push_back(QString("%1 %2 %3").arg(joint).arg(u).arg(v));
+    }
+}
+
+void MainWindow::macro_frame_ready()
+{
+    //Every line due this tick has been applied, draw them once
+    ui->graphicsView->change_joints_config(mPlayer.changed_joints(), mJoints);
+    ui->graphicsView->request_redraw();
+    mRateLabel->setText(QString("Frame %1/%2, %3 of %4 fps, %5 dropped")
+                        .arg(mPlayer.frame()).arg(mPlayer.frame_count())
+                        .arg(mPlayer.achieved_rate(),0,'f',1).arg(mPlayer.target_rate(),0,'f',1)
+                        .arg(mPlayer.dropped_frames()));
+}
+
+void MainWindow::macro_finished()
+{
+    update_macro_actions();
     if (mRow_edit!=-1)
     {
         double u,v;
-        auto it = mList.begin();
-        std::advance(it,mRow_edit);
-        (*it)->get_axis(u,v);
+        mJoints.get_axis(mRow_edit,u,v);
         ui->lineEdit_V->setText(QString("%1").arg(v));
         ui->lineEdit_U->setText(QString("%1").arg(u));
         on_lineEdit_U_editingFinished();
         on_lineEdit_V_editingFinished();
     }
 }
+
+void MainWindow::update_macro_actions()
+{
+    bool loaded = mPlayer.frame_count() > 0;
+    ui->actionPause_Macro->setEnabled(loaded);
+    ui->actionPause_Macro->setChecked(loaded && !mPlayer.is_playing());
+    ui->actionSeek_Macro->setEnabled(loaded);
+}
@@ -19,6 +19,8 @@
 #include "osgwidget.h"
 #include <vector>
 #include "inputwindow.h"
+#include "macroplayer.h"
+#include <QLabel>
 
 namespace Ui {
 class MainWindow;
@@ -66,15 +68,27 @@ private slots:
     void on_actionRecord_Macro_triggered(bool checked);
 
     void on_actionRun_Macro_triggered(bool checked);
+    void on_actionConvert_Macro_triggered(bool checked);
+    void on_actionPause_Macro_triggered(bool checked);
+    void on_actionSeek_Macro_triggered(bool checked);
+    void on_actionMacro_Speed_triggered(bool checked);
+    void on_actionCount_State_Sets_triggered(bool checked);
+    void on_actionRecord_Trace_triggered(bool checked);
+    void on_actionRecord_Render_Stats_triggered(bool checked);
+
+    void macro_line_applied(int joint, double u, double v);
+    void macro_frame_ready();
+    void macro_finished();
 
     void shapecreated(QString shape, osg::Vec3 size, osg::Vec3 translation, osg::Vec3 rotation, osg::Vec3 color);
 
     void show_matrix();
+    void collisions_checked(int contacts, int self_contacts, double max_depth, double query_ms);
 
 
 protected:
     //stores all joint information
-    std::list<Joint*> mList;
+    JointStore mJoints;
 
     //Determines whether or not the program has been saved
     bool mSave{true};
@@ -93,10 +107,16 @@ private:
     void update_color_label();
     std::vector<QString> mMacro;
     bool mRecordMacro{false};
+    Macro mPlayback;
+    MacroPlayer mPlayer;
+    QLabel *mRateLabel;
+    QLabel *mStateLabel;
     int mNumShapes{0};
 
     void save_macro();
     void update_UV();
+    void update_macro_actions();
+    void update_state_label();
 
 };
 
@@ -1,9 +1,9 @@
 #include "OSGWidget.h"
+#include "trace.h"
 
 #include <osg/Camera>
 #include <osg/DisplaySettings>
 #include <osg/Geode>
-#include <osg/Material>
 #include <osg/Shape>
 #include <osg/StateSet>
 #include <osgDB/WriteFile>
@@ -13,13 +13,14 @@
 #include <osg/MatrixTransform>
 #include <osgUtil/SmoothingVisitor>
 
+#include <algorithm>
 #include <cassert>
 #include <vector>
 #include <list>
 #include <string>
 
 #include <QKeyEvent>
-#include <QPainter>
+#include <QMouseEvent>
 #include <QWheelEvent>
 
 OSGWidget::OSGWidget(QWidget* parent, Qt::WindowFlags f ):
@@ -30,7 +31,24 @@ OSGWidget::OSGWidget(QWidget* parent, Qt::WindowFlags f ):
                                                             this->height() ) }
   , mViewer{ new osgViewer::CompositeViewer }
 {
-    mRoot = new osg::Group;
+    //Bursts of redraw requests become one frame per budget
+    mRedrawTimer.setSingleShot(true);
+    mRedrawTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mRedrawTimer, SIGNAL(timeout()), this, SLOT(redraw()));
+    //Qt composes and resizes the framebuffer with the context on this thread.
+    //Composing only reads the framebuffer, resizing also changes the camera.
+    connect(this, SIGNAL(aboutToCompose()), this, SLOT(lock_draw()));
+    connect(this, SIGNAL(frameSwapped()), this, SLOT(unlock_draw()));
+    connect(this, SIGNAL(aboutToResize()), this, SLOT(lock_scene()));
+    connect(this, SIGNAL(aboutToResize()), this, SLOT(lock_draw()));
+    connect(this, SIGNAL(resized()), this, SLOT(unlock_draw()));
+    connect(this, SIGNAL(resized()), this, SLOT(unlock_scene()));
+
+    //The joint spheres are drawn in world coordinates, next to the registry rather than in it
+    mSphereInstancer = new SphereInstancer;
+    mScene = new osg::Group;
+    mScene->addChild(mRegistry.root());
+    mScene->addChild(mSphereInstancer.get());
 
     float aspectRatio = static_cast<float>( this->width() ) / static_cast<float>( this->height() );
     auto pixelRatio   = this->devicePixelRatio();
@@ -46,7 +64,7 @@ OSGWidget::OSGWidget(QWidget* parent, Qt::WindowFlags f ):
     //Set up the view
     osgViewer::View* view = new osgViewer::View;
     view->setCamera( camera );
-    view->setSceneData( mRoot.get() );
+    view->setSceneData( mScene.get() );
     view->addEventHandler( new osgViewer::StatsHandler );
 
     //Set up the mouse control
@@ -75,29 +93,166 @@ OSGWidget::OSGWidget(QWidget* parent, Qt::WindowFlags f ):
 }
 
 OSGWidget::~OSGWidget()
-{}
+{
+    set_render_thread(false);
+}
 
-void OSGWidget::paintEvent( QPaintEvent* /* paintEvent */ )
+void OSGWidget::paintEvent( QPaintEvent* paintEvent )
 {
-    this->makeCurrent();
+    //The render thread has already drawn into the framebuffer, Qt only composes it
+    if (mRenderer)
+        return;
+    QOpenGLWidget::paintEvent(paintEvent);
+}
 
-    QPainter painter( this );
-    painter.setRenderHint( QPainter::Antialiasing );
+void OSGWidget::paintGL()
+{
+    TRACE_SCOPE("paintGL");
+    mFrameClock.start();
+    mViewer->frame();
+    mFrameTime = mFrameClock.nsecsElapsed()/1e6;
+    if (mFrameTime > mFrameBudget)
+        mFramesOverBudget++;
+    mRenderStats.sample(mViewer.get(), mFrameTime);
+
+    //Events that arrived during the frame, or a manipulator still moving, need another one
+    if (mViewer->checkNeedToDoFrame())
+        request_redraw();
+    emit frame_drawn();
+}
 
-    this->paintGL();
+void OSGWidget::request_redraw()
+{
+    if (mRedrawTimer.isActive())
+        return;
+    //Wait out the rest of the budget since the last frame started, then draw once
+    double wait = mFrameClock.isValid() ? mFrameBudget - mFrameClock.nsecsElapsed()/1e6 : 0;
+    mRedrawTimer.start(wait > 0 ? int(wait) : 0);
+}
 
-    painter.end();
+void OSGWidget::redraw()
+{
+    if (!mRenderer)
+    {
+        update();
+        return;
+    }
+    //One frame on the render thread at a time, requests meanwhile become one more frame
+    if (mFramePending)
+    {
+        mRedrawAfterFrame = true;
+        return;
+    }
+    mFramePending = true;
+    mRedrawAfterFrame = false;
+    mFrameClock.start();
+    QMetaObject::invokeMethod(mRenderer, "render", Qt::QueuedConnection);
+}
 
-    this->doneCurrent();
+void OSGWidget::grab_context()
+{
+    if (mRenderer)
+        mRenderer->grab_context(mRenderQThread);
 }
 
-void OSGWidget::paintGL()
+void OSGWidget::frame_rendered(double ms, bool more)
 {
-    mViewer->frame();
+    mFramePending = false;
+    mFrameTime = ms;
+    if (mFrameTime > mFrameBudget)
+        mFramesOverBudget++;
+    {
+        //The next frame has not been started yet, but the cameras belong to the scene
+        QMutexLocker lock(&mSceneMutex);
+        mRenderStats.sample(mViewer.get(), mFrameTime);
+    }
+    //Compose the new framebuffer contents
+    update();
+    if (more || mRedrawAfterFrame)
+        request_redraw();
+    emit frame_drawn();
+}
+
+void OSGWidget::lock_scene()
+{
+    mSceneMutex.lock();
+}
+
+void OSGWidget::unlock_scene()
+{
+    mSceneMutex.unlock();
+}
+
+void OSGWidget::lock_draw()
+{
+    mDrawMutex.lock();
+}
+
+void OSGWidget::unlock_draw()
+{
+    mDrawMutex.unlock();
+}
+
+void OSGWidget::set_render_thread(bool on)
+{
+    if (on == render_thread())
+        return;
+    if (on)
+    {
+        mRenderQThread = new QThread(this);
+        mRenderer = new RenderThread(this, mViewer.get(), mViewer->getView(0)->getCamera(), &mSceneMutex, &mDrawMutex);
+        mRenderer->moveToThread(mRenderQThread);
+        connect(mRenderer, SIGNAL(context_wanted()), this, SLOT(grab_context()));
+        connect(mRenderer, SIGNAL(frame_rendered(double,bool)), this, SLOT(frame_rendered(double,bool)));
+        mRenderQThread->start();
+    }
+    else
+    {
+        mRenderer->prepare_exit();
+        mRenderQThread->quit();
+        mRenderQThread->wait();
+        delete mRenderer;
+        delete mRenderQThread;
+        mRenderer = nullptr;
+        mRenderQThread = nullptr;
+        mFramePending = false;
+    }
+    request_redraw();
+}
+
+RenderStats &OSGWidget::render_stats()
+{
+    return mRenderStats;
+}
+
+bool OSGWidget::render_thread() const
+{
+    return mRenderer != nullptr;
+}
+
+void OSGWidget::set_frame_budget(double ms)
+{
+    mFrameBudget = ms;
+}
+
+double OSGWidget::frame_budget() const
+{
+    return mFrameBudget;
+}
+
+double OSGWidget::frame_time() const
+{
+    return mFrameTime;
+}
+
+int OSGWidget::frames_over_budget() const
+{
+    return mFramesOverBudget;
 }
 
 void OSGWidget::resizeGL( int width, int height )
 {
+    QMutexLocker lock(&mSceneMutex);
     this->getEventQueue()->windowResize( this->x(), this->y(), width, height );
     mGraphicsWindow->resized( this->x(), this->y(), width, height );
 
@@ -129,6 +284,10 @@ void OSGWidget::keyReleaseEvent( QKeyEvent* event )
 
 void OSGWidget::mouseMoveEvent( QMouseEvent* event )
 {
+    //The manipulator only moves the camera while dragging
+    if (event->buttons() == Qt::NoButton)
+        return;
+
     auto pixelRatio = this->devicePixelRatio();
 
     this->getEventQueue()->mouseMotion( static_cast<float>( event->x() * pixelRatio ),
@@ -228,9 +387,14 @@ bool OSGWidget::event( QEvent* event )
     case QEvent::MouseButtonDblClick:
     case QEvent::MouseButtonPress:
     case QEvent::MouseButtonRelease:
-    case QEvent::MouseMove:
     case QEvent::Wheel:
-        this->update();
+        this->request_redraw();
+        break;
+
+    case QEvent::MouseMove:
+        //Hovering does not change the view
+        if (static_cast<QMouseEvent*>(event)->buttons() != Qt::NoButton)
+            this->request_redraw();
         break;
 
     default:
@@ -241,50 +405,71 @@ bool OSGWidget::event( QEvent* event )
 
 void OSGWidget::view_floor(bool view)
 {
+    QMutexLocker lock(&mSceneMutex);
+    QMutexLocker draw(&mDrawMutex);
     mFloor = view;
     if (view)
     {
-        mRoot->insertChild(0, create_box(osg::Vec3(100,100,.5),osg::Vec3(0,0,-.25),osg::Vec3(0,0,0),osg::Vec3(0,100,255)));
-        mOffset++;
+        mFloorHandle = mRegistry.add(LAYER_FLOOR, create_box(osg::Vec3(100,100,.5),osg::Vec3(0,0,-.25),osg::Vec3(0,0,0),osg::Vec3(0,100,255)));
     }
     else
     {
-        mRoot->removeChild(0,1);
-        mOffset--;
+        mRegistry.remove(mFloorHandle);
+        mFloorHandle = INVALID_SCENE_HANDLE;
     }
 }
 
 void OSGWidget::select_joint(int i, bool selected)
 {
-    osg::Geode* node;
-    node = mRoot->getChild(i+mOffset)->asTransform()->getChild(0)->asGeode();
-    double val;
-    if (selected)
-        val = 1;
-    else
-        val = .5;
-
-    for (int i = 0; i < node->getNumChildren()-2; i++)
-    {
-        dynamic_cast<osg::ShapeDrawable*>(node->getChild(i+2)->asTransform()->getChild(0))->setColor(osg::Vec4( val, val, val, 1.f));
-    }
+    QMutexLocker lock(&mSceneMutex);
+    mHighlight = selected ? i : (mHighlight == i ? -1 : mHighlight);
+    mSphereInstancer->set_highlight(mHighlight);
 }
 
 void OSGWidget::reset()
 {
-    mOffset = 0;
-    mRoot->removeChild(0,mRoot->getNumChildren());
+    QMutexLocker lock(&mSceneMutex);
+    QMutexLocker draw(&mDrawMutex);
+    for (std::size_t k = 0; k < mJointNodes.size(); k++)
+    {
+        mGeodeLookup.erase(mJointNodes[k]);
+        delete mJointNodes[k];
+    }
+    mJointNodes.clear();
+    mJointHandles.clear();
+    mJointTransforms.clear();
+    mFrames.invalidate_all();
+    mObstacles.clear();
+    mObstacleIds.clear();
+    mShapeHandles.clear();
+    mContacts.clear();
+    mSelfContacts.clear();
+    mSpheres.clear();
+    mSphereInstancer->set_spheres(mSpheres);
+    mHighlight = -1;
+    mSphereInstancer->set_highlight(mHighlight);
+    mRegistry.clear();
+    mFloorHandle = INVALID_SCENE_HANDLE;
+    mAxisHandle = INVALID_SCENE_HANDLE;
     this->drawAxis(true);
 }
 
-bool OSGWidget::removeShape(int id)
+bool OSGWidget::removeShape()
 {
-    mRoot->removeChild(id,1);
-    mOffset--;
+    QMutexLocker lock(&mSceneMutex);
+    QMutexLocker draw(&mDrawMutex);
+    if (mShapeHandles.empty())
+        return false;
+    mRegistry.remove(mShapeHandles.back());
+    mShapeHandles.pop_back();
+    mObstacles.remove(mObstacleIds.back());
+    mObstacleIds.pop_back();
+    return true;
 }
 
 osg::Geode* OSGWidget::draw_joint(Joint* joint)
 {
+    TRACE_SCOPE("draw_joint");
     double r, g, b;
     double h, rad;
     joint->get_size(h,rad);
@@ -293,258 +478,352 @@ osg::Geode* OSGWidget::draw_joint(Joint* joint)
     g = g/255.0;
     b = b/255.0;
     // What Value should we make the height of these cylinders? Maybe rad/4.0?
-    osg::Cylinder* cylinder = new osg::Cylinder(osg::Vec3(0.f, 0.f, 0.f), rad, 1);
-    osg::ShapeDrawable* sd = new osg::ShapeDrawable(cylinder);
-    sd->setColor(osg::Vec4(r, g, b, 1.f));
-
-    osg::ShapeDrawable* sd1 = new osg::ShapeDrawable(cylinder);
-    sd1->setColor(osg::Vec4(r, g, b, 1.f));
-    sd->setName("Base");
-    sd1->setName("End");
+    osg::Vec4 color(r, g, b, 1.f);
+    osg::Node* base = lod_cylinder(rad, color, "Base");
+    osg::Node* end = lod_cylinder(rad, color, "End");
 
     // transform the end effector to the correct frame
     osg::MatrixTransform* transform = joint->get_T();
-    transform->addChild(sd1);
+    transform->addChild(end);
 
     //Create the node to hold the joint
     osg::Geode* joint_geode = new osg::Geode;
-    joint_geode->addChild(sd);
+    joint_geode->addChild(base);
     joint_geode->addChild(transform);
 
-    for(int i = 0; i < joint->get_sphere_count(); i++)
-    {
-        osg::Sphere* sphere = new osg::Sphere( osg::Vec3( 0.f, 0.f, 0.f ), .9*rad );
-        osg::ShapeDrawable* sdi = new osg::ShapeDrawable( sphere );
-        sdi->setColor( osg::Vec4( .5, .5, .5, 1.f ) );
-        sdi->setName(QString("Sphere %1").arg(i).toStdString());
-        osg::MatrixTransform* Ti = joint->get_Ti(i);
-        Ti->addChild(sdi);
-
-        joint_geode->addChild(Ti);
-    }
-
-    // Set material for basic lighting and enable depth tests.
-    osg::StateSet* stateSet = joint_geode->getOrCreateStateSet();
-    osg::Material* material = new osg::Material;
-    material->setColorMode( osg::Material::AMBIENT_AND_DIFFUSE );
-    stateSet->setAttributeAndModes( material, osg::StateAttribute::ON );
-    stateSet->setMode( GL_DEPTH_TEST, osg::StateAttribute::ON );
+    //Every joint shares one lit state, the color is on the drawables
+    joint_geode->setStateSet(mStateCache.get(MATERIAL_LIT));
     mGeodeLookup[joint] = joint_geode;
     return joint_geode;
 }
 
-void OSGWidget::update_joint_size(Joint* joint, double h, double rad)
+osg::Node* OSGWidget::lod_cylinder(double rad, const osg::Vec4 &color, const std::string &name)
 {
-    osg::Geode* joint_geode = mGeodeLookup[joint];
-    for(int i = 0; i < joint->get_sphere_count(); i++)
-    {
-        joint_geode->removeChild(joint->get_Ti(i));
-    }
-    joint->set_size(h,rad);
-    for(int i = 0; i < joint->get_sphere_count(); i++)
+    //Pixel size below which the next coarser tessellation is drawn
+    static const double thresholds[] = {40, 12};
+    static const float detail[] = {1.f, .4f, .15f};
+
+    HysteresisLod* lod = new HysteresisLod;
+    lod->set_thresholds(thresholds, 2);
+    lod->setName(name);
+    osg::Cylinder* cylinder = new osg::Cylinder(osg::Vec3(0.f, 0.f, 0.f), rad, 1);
+    for (int i = 0; i < 3; i++)
     {
-        osg::Sphere* sphere = new osg::Sphere( osg::Vec3( 0.f, 0.f, 0.f ), .9*rad );
-        osg::ShapeDrawable* sdi = new osg::ShapeDrawable( sphere );
-        sdi->setColor( osg::Vec4( 1.f, 1.f, 1.f, 1.f ) );
-        sdi->setName(QString("Sphere %1").arg(i).toStdString());
-        osg::MatrixTransform* Ti = joint->get_Ti(i);
-        Ti->addChild(sdi);
-        joint_geode->addChild(Ti);
+        osg::TessellationHints* hints = new osg::TessellationHints;
+        hints->setDetailRatio(detail[i]);
+        osg::ShapeDrawable* sd = new osg::ShapeDrawable(cylinder, hints);
+        sd->setColor(color);
+        sd->setName(name);
+        lod->addChild(sd);
     }
-    update();
+    return lod;
+}
+
+void OSGWidget::update_joint_size(int i, JointStore &joints, double h, double rad)
+{
+    QMutexLocker lock(&mSceneMutex);
+    mJointNodes[i]->set_size(h,rad);
+    mFrames.invalidate(i);
+    update_spheres(joints);
+    request_redraw();
 }
 
 void OSGWidget::create_shape(QString shape, osg::Vec3 size, osg::Vec3 translation, osg::Vec3 rotation, osg::Vec3 color)
 {
+    QMutexLocker lock(&mSceneMutex);
     //declare variables
     osg::ShapeDrawable* sd;
-    int j{0};
-
-    //establishes where to insert the shape in the root
-    if (mFloor)
-        j++;
+    Obstacle obstacle;
+    obstacle.size[0] = size.x();
+    obstacle.size[1] = size.y();
+    obstacle.size[2] = size.z();
 
     if (shape == "box")
     {
+        obstacle.shape = SHAPE_BOX;
         osg::Box* box = new osg::Box( osg::Vec3( 0.f, 0.f, size.z()/2), size.x(),size.y(),size.z() );
         sd = new osg::ShapeDrawable( box );
     }
     else if (shape == "cone")
     {
+        obstacle.shape = SHAPE_CONE;
         osg::Cone* cone = new osg::Cone( osg::Vec3( 0.f, 0.f, size.x()/4 ), size.y(), size.x());
         sd = new osg::ShapeDrawable( cone );
     }
     else if (shape == "cylinder")
     {
+        obstacle.shape = SHAPE_CYLINDER;
         osg::Cylinder* cylinder = new osg::Cylinder( osg::Vec3(0.f,0.f,size.x()/2), size.y(), size.x());
         sd = new osg::ShapeDrawable(cylinder);
     }
     else if (shape == "sphere")
     {
+        obstacle.shape = SHAPE_SPHERE;
         osg::Sphere* sphere = new osg::Sphere( osg::Vec3( 0.f, 0.f, size.x() ), size.x());
         sd = new osg::ShapeDrawable( sphere );
     }
 
     //Finishes defining the shape, then inserts it into the graphics view
-    mRoot->insertChild(j, shape_setup(sd, translation, rotation, color));
+    mShapeHandles.push_back(mRegistry.add(LAYER_SHAPES, shape_setup(sd, translation, rotation, color)));
 
-    mOffset++;
+    double t[3] = {translation.x(), translation.y(), translation.z()};
+    double r[3] = {rotation.x(), rotation.y(), rotation.z()};
+    obstacle.pose = shape_pose(t, r);
+    mObstacleIds.push_back(mObstacles.add(obstacle));
 }
 
-void OSGWidget::set_starting_pose(osg::MatrixTransform* transform)
+void OSGWidget::set_starting_pose(osg::MatrixTransform* transform, JointStore &joints)
 {
-    mStarting_pose->setMatrix(transform->getMatrix());
-    if (mRoot->getNumChildren()>mOffset)
-        mRoot->getChild(mOffset)->asTransform()->asMatrixTransform()->setMatrix(mStarting_pose->getMatrix());
+    QMutexLocker lock(&mSceneMutex);
+    joints.set_base(to_frame(transform->getMatrix()));
+    mFrames.invalidate_base();
+    if (!mJointTransforms.empty())
+        joint_transform(0)->setMatrix(transform->getMatrix());
 }
 
-osg::MatrixTransform *OSGWidget::output_matrix(int i, std::list<Joint *> &list)
+osg::MatrixTransform *OSGWidget::output_matrix(int i, JointStore &joints)
 {
+    QMutexLocker lock(&mSceneMutex);
     osg::MatrixTransform* m = new osg::MatrixTransform;
+    m->setMatrix(to_matrix(mFrames.end_frame(joints.chain(),i)));
+    return m;
+}
 
-    //Make it point to the correct object in the list
-    std::list<Joint*>::iterator it= list.begin();
-    std::advance(it,i);
+osg::MatrixTransform* OSGWidget::joint_transform(std::size_t i) const
+{
+    return mJointTransforms[i].get();
+}
 
-    if (list.size() == 1)
+bool OSGWidget::use_nested(std::size_t joints) const
+{
+    if (mLayout == LAYOUT_AUTO)
+        return joints <= NESTED_JOINT_LIMIT;
+    return mLayout == LAYOUT_NESTED;
+}
+
+void OSGWidget::attach_joint(std::size_t i, JointStore &joints)
+{
+    osg::MatrixTransform* m = mJointTransforms[i].get();
+    if (mNested && i > 0)
     {
-        m->setMatrix(((*it)->get_T())->getMatrix()*mStarting_pose->getMatrix());
+        //Hangs from the end frame of the joint before it, one gap further along its z axis
+        mJointHandles[i] = INVALID_SCENE_HANDLE;
+        mJointNodes[i-1]->get_T()->addChild(m);
+        m->setMatrix(osg::Matrix::translate(0, 0, JOINT_GAP));
     }
     else
     {
-        m->setMatrix(((*it)->get_T())->getMatrix()* mRoot->getChild(i+mOffset)->asTransform()->asMatrixTransform()->getMatrix());
+        mJointHandles[i] = mRegistry.add(LAYER_JOINTS, m);
+        m->setMatrix(to_matrix(mFrames.base_frame(joints.chain(),i)));
     }
-    return m;
 }
 
-void OSGWidget::create_arm(std::list<Joint *> &list)
+void OSGWidget::detach_joint(std::size_t i)
 {
-    osg::MatrixTransform* prev_m = new osg::MatrixTransform;
+    //mJointTransforms keeps the node alive while it is detached
+    if (mJointHandles[i] != INVALID_SCENE_HANDLE)
+        mRegistry.remove(mJointHandles[i]);
+    else
+        mJointNodes[i-1]->get_T()->removeChild(mJointTransforms[i].get());
+    mJointHandles[i] = INVALID_SCENE_HANDLE;
+}
 
-    //Make it point to the last object in the list
-    std::list<Joint*>::iterator it=list.end();
-    it--;
+void OSGWidget::relayout(JointStore &joints)
+{
+    bool nested = use_nested(joints.size());
+    if (nested == mNested)
+        return;
+    for (std::size_t k = mJointTransforms.size(); k > 0; k--)
+        detach_joint(k-1);
+    mNested = nested;
+    for (std::size_t k = 0; k < mJointTransforms.size(); k++)
+        attach_joint(k, joints);
+}
 
-    prev_m->addChild(draw_joint(*it));
+void OSGWidget::set_joint_layout(JointLayout layout, JointStore &joints)
+{
+    QMutexLocker lock(&mSceneMutex);
+    QMutexLocker draw(&mDrawMutex);
+    mLayout = layout;
+    relayout(joints);
+}
 
-    if (list.size() == 1)
-    {
-        //SET ROBOT STARTING POSITION HERE
-        prev_m->setMatrix(mStarting_pose->getMatrix());
-    }
-    else
-    {
-        it--;
-        //ORDER OF MULTIPLICATION: First, offset. Second, Previous Joint Matrix. Third, Previous Translation matrix.
-        prev_m->setMatrix( osg::Matrix::translate(0,0,1)*((*it)->get_T())->getMatrix()* mRoot->getChild(list.size()+(mOffset-2))->asTransform()->asMatrixTransform()->getMatrix() );
-    }
-    //Multiply the joint by all the transformations
-    mRoot->addChild(prev_m);
+bool OSGWidget::nested_joints() const
+{
+    return mNested;
+}
+
+void OSGWidget::update_spheres(JointStore &joints)
+{
+    TRACE_SCOPE("update_spheres");
+    //Spheres come from the cached frames, so this stays cheap between edits
+    chain_spheres(joints, mFrames, mSpheres);
+    mSphereInstancer->set_spheres(mSpheres);
+    check_collisions();
+}
+
+bool OSGWidget::check_collisions()
+{
+    bool hit = mObstacles.query(mSpheres, mContacts);
+    hit = mSelfCollision.query(mSpheres, mSelfContacts) || hit;
+    const CollisionStats &stats = mObstacles.stats();
+    const SelfCollisionStats &self_stats = mSelfCollision.stats();
+    emit collisions_checked(mContacts.size(), mSelfContacts.size(), std::max(stats.max_depth, self_stats.max_depth),
+                            stats.query_ms + self_stats.query_ms);
+    return hit;
+}
+
+std::size_t OSGWidget::unique_states()
+{
+    QMutexLocker lock(&mSceneMutex);
+    return count_states(mScene.get());
+}
+
+const std::vector<Contact> &OSGWidget::contacts() const
+{
+    return mContacts;
+}
+
+const std::vector<SelfContact> &OSGWidget::self_contacts() const
+{
+    return mSelfContacts;
 }
 
-void OSGWidget::open_arm(std::list<Joint *> &list)
+void OSGWidget::create_arm(JointStore &joints)
 {
+    TRACE_SCOPE("create_arm");
+    QMutexLocker lock(&mSceneMutex);
+    QMutexLocker draw(&mDrawMutex);
     osg::MatrixTransform* prev_m = new osg::MatrixTransform;
 
-    // SET ROBOT STARTING POINT HERE
-    prev_m->setMatrix(osg::Matrix::translate(0,0,.5));
+    //The new joint is the last one in the store
+    std::size_t i = joints.size()-1;
+    Joint* joint = new Joint(&joints, joints.handle(i));
+    mJointNodes.push_back(joint);
+    mFrames.invalidate(i);
+
+    prev_m->addChild(draw_joint(joint));
+    mJointTransforms.push_back(prev_m);
+    mJointHandles.push_back(INVALID_SCENE_HANDLE);
 
-    std::list<Joint*>::iterator it=list.begin();
-    for(it; it!=list.end();it++)
+    //The cache grows by the new joint only, every frame before it is reused
+    attach_joint(i, joints);
+    relayout(joints);
+    update_spheres(joints);
+}
+
+void OSGWidget::open_arm(JointStore &joints)
+{
+    TRACE_SCOPE("open_arm");
+    QMutexLocker lock(&mSceneMutex);
+    mFrames.invalidate_all();
+    mNested = use_nested(joints.size());
+
+    for(std::size_t i = 0; i < joints.size(); i++)
     {
+        Joint* joint = new Joint(&joints, joints.handle(i));
+        mJointNodes.push_back(joint);
+
         osg::MatrixTransform* m = new osg::MatrixTransform;
-        if (it == list.begin())
-        {
-            prev_m->setMatrix(mStarting_pose->getMatrix());
-        }
-        else
-        {
-            it--;
-            prev_m->setMatrix( (osg::Matrix::translate(0, 0, 1)*((*it)->get_T())->getMatrix())*prev_m->getMatrix() );
-            it++;
-        }
-        if (it!= list.end())
+        m->addChild(draw_joint(joint));
+        mJointTransforms.push_back(m);
+        mJointHandles.push_back(INVALID_SCENE_HANDLE);
+        attach_joint(i, joints);
+    }
+    update_spheres(joints);
+}
+
+void OSGWidget::erase_joint(int i, JointStore &joints)
+{
+    TRACE_SCOPE("erase_joint");
+    QMutexLocker lock(&mSceneMutex);
+    QMutexLocker draw(&mDrawMutex);
+    //The joint has already been removed from the store
+    //When nested, the rest of the chain hangs from joint i and moves over to joint i-1
+    bool reattach = mNested && std::size_t(i)+1 < mJointTransforms.size();
+    if (reattach)
+        detach_joint(i+1);
+    detach_joint(i);
+    mJointTransforms.erase(mJointTransforms.begin()+i);
+    mJointHandles.erase(mJointHandles.begin()+i);
+    mGeodeLookup.erase(mJointNodes[i]);
+    delete mJointNodes[i];
+    mJointNodes.erase(mJointNodes.begin()+i);
+    mFrames.erase(i);
+
+    if (reattach)
+        attach_joint(i, joints);
+    else if (!mNested)
+    {
+        //Joints after i now hang from joint i-1, so only their matrices change
+        for (std::size_t k = i; k < joints.size(); k++)
         {
-            m->addChild(draw_joint(*it));
-            m->setMatrix(prev_m->getMatrix());
-            mRoot->addChild(m);
+            joint_transform(k)->setMatrix(to_matrix(mFrames.base_frame(joints.chain(),k)));
         }
     }
+    relayout(joints);
+    update_spheres(joints);
 }
 
-void OSGWidget::erase_joint(int i, std::list<Joint *> &list)
+void OSGWidget::change_joint_config(int i, JointStore &joints)
 {
-    std::list<Joint*>::iterator it= list.begin();
-    std::advance(it,i);
-
-    //This will adjust the matrix transforms for all affected joints when delete joint is called
-    for (int k = (mRoot->getNumChildren()); k > i+mOffset+1; k--)
+    TRACE_SCOPE("change_joint_config");
+    QMutexLocker lock(&mSceneMutex);
+    mJointNodes[i]->update_T();
+    mFrames.invalidate(i);
+
+    //Only joints after i move, and their frames are rebuilt from the cached frame of joint i.
+    //Nested joints follow their parent during traversal.
+    for (std::size_t k = i+1; !mNested && k < joints.size(); k++)
     {
-        mRoot->getChild(k-1)->asTransform()->asMatrixTransform()->setMatrix( mRoot->getChild(k-2)->asTransform()->asMatrixTransform()->getMatrix() );
+        joint_transform(k)->setMatrix(to_matrix(mFrames.base_frame(joints.chain(),k)));
     }
-
-    mRoot->removeChild(i+mOffset,1);
+    update_spheres(joints);
 }
 
-void OSGWidget::change_joint_config(int i, std::list<Joint *> &list)
+void OSGWidget::change_joints_config(const std::vector<std::size_t> &changed, JointStore &joints)
 {
-    std::list<Joint*>::iterator it= list.begin();
-    std::advance(it,i);
-
-    // The new matrix for our joint configuration
-    osg::MatrixTransform* matrix = new osg::MatrixTransform;
-    matrix = (*it)->get_T();
-    osg::MatrixTransform* prev_m = new osg::MatrixTransform;
-
-    //set j to the last index in the mRoot list
-    int j = mRoot->getNumChildren();
-    j--;
-
-    int k{0};
+    TRACE_SCOPE("change_joints_config");
+    QMutexLocker lock(&mSceneMutex);
+    if (changed.empty())
+        return;
 
-    it=list.begin();
-    for(it; it!=list.end();it++)
+    //Several joints changed at once, so move everything after the first of them only once
+    std::size_t first = changed[0];
+    for (std::size_t k = 0; k < changed.size(); k++)
     {
-        if (it == list.begin())
-        {
-            prev_m->setMatrix(mStarting_pose->getMatrix());
-        }
-        else
-        {
-            it--;
-            prev_m->setMatrix( osg::Matrix::translate(0, 0, 1)*((*it)->get_T())->getMatrix()*(prev_m->getMatrix()) ); //
-            it++;
-        }
-        if (k>i) //Checks to see if the joint is affected by the changed T matrix
-        {
-            osg::MatrixTransform* mat = new osg::MatrixTransform;
-            mat->setMatrix(prev_m->getMatrix());
-            i++;
-            if (i+mOffset<=j) //Makes sure it doesnt step past the index of mRoot
-            {
-                mRoot->getChild(i+mOffset)->asTransform()->asMatrixTransform()->setMatrix( mat->getMatrix() );
-            }
-        }
-        k++;
+        mJointNodes[changed[k]]->update_T();
+        mFrames.invalidate(changed[k]);
+        first = std::min(first, changed[k]);
     }
+    for (std::size_t k = first+1; !mNested && k < joints.size(); k++)
+    {
+        joint_transform(k)->setMatrix(to_matrix(mFrames.base_frame(joints.chain(),k)));
+    }
+    update_spheres(joints);
 }
 
-void OSGWidget::joint_color(int i, Joint *joint)
+void OSGWidget::joint_color(int i, JointStore &joints)
 {
-    osg::Geode* node = new osg::Geode;
+    QMutexLocker lock(&mSceneMutex);
+    QMutexLocker draw(&mDrawMutex);
+    osg::Geode* node;
     double r, g, b;
-    joint->get_color(r,g,b);
+    joints.get_color(i,r,g,b);
     r = r/255.0;
     g = g/255.0;
     b = b/255.0;
-    node = mRoot->getChild(i+mOffset)->asTransform()->getChild(0)->asGeode();
-    // Start and End of Joint
-    dynamic_cast<osg::ShapeDrawable*>(node->getChild(0))->setColor(osg::Vec4(r, g, b, 1.f));
-    dynamic_cast<osg::ShapeDrawable*>(node->getChild(1)->asTransform()->getChild(0))->setColor(osg::Vec4(r, g, b, 1.f));
+    node = joint_transform(i)->getChild(0)->asGeode();
+    // Start and End of Joint, every level of detail
+    set_shape_color(node->getChild(0), osg::Vec4(r, g, b, 1.f));
+    //Only the end cap, nested joints after this one also hang from the end transform
+    set_shape_color(node->getChild(1)->asGroup()->getChild(0), osg::Vec4(r, g, b, 1.f));
 }
 
 void OSGWidget::drawAxis(bool show)
 {
+    QMutexLocker lock(&mSceneMutex);
+    QMutexLocker draw(&mDrawMutex);
     if (show)
     {
         osg::Geode* geode = new osg::Geode;
@@ -555,13 +834,12 @@ void OSGWidget::drawAxis(bool show)
         //z axis, blue
         geode->addChild(create_box(osg::Vec3(.5,.5,25), osg::Vec3(0,0,12.5), osg::Vec3(0,0,0), osg::Vec3(0,0,255)));
 
-        mRoot->insertChild(mOffset,geode);
-        mOffset++;
+        mAxisHandle = mRegistry.add(LAYER_AXIS, geode);
     }
     else
     {
-        mRoot->removeChild(mOffset-1,1);
-        mOffset--;
+        mRegistry.remove(mAxisHandle);
+        mAxisHandle = INVALID_SCENE_HANDLE;
     }
 }
 
@@ -579,13 +857,7 @@ osg::MatrixTransform* OSGWidget::create_box(osg::Vec3 size, osg::Vec3 translatio
     sd->setName( (QString("%1").arg(currentID)).toStdString() );
     osg::Geode* geode = new osg::Geode;
     geode->addDrawable( sd );
-    osg::StateSet* stateSet = geode->getOrCreateStateSet();
-    osg::Material* material = new osg::Material;
-
-    material->setColorMode( osg::Material::AMBIENT_AND_DIFFUSE );
-
-    stateSet->setAttributeAndModes( material, osg::StateAttribute::ON );
-    stateSet->setMode( GL_DEPTH_TEST, osg::StateAttribute::ON );
+    geode->setStateSet(mStateCache.get(MATERIAL_LIT));
 
     //Set up transform parent node.
     osg::MatrixTransform* transform= new osg::MatrixTransform;
@@ -617,13 +889,7 @@ osg::MatrixTransform *OSGWidget::shape_setup(osg::ShapeDrawable *sd, osg::Vec3 t
     sd->setName( (QString("%1").arg(currentID)).toStdString() );
     osg::Geode* geode = new osg::Geode;
     geode->addDrawable( sd );
-    osg::StateSet* stateSet = geode->getOrCreateStateSet();
-    osg::Material* material = new osg::Material;
-
-    material->setColorMode( osg::Material::AMBIENT_AND_DIFFUSE );
-
-    stateSet->setAttributeAndModes( material, osg::StateAttribute::ON );
-    stateSet->setMode( GL_DEPTH_TEST, osg::StateAttribute::ON );
+    geode->setStateSet(mStateCache.get(MATERIAL_LIT));
 
     //Set up transform parent node.
     osg::MatrixTransform* transform= new osg::MatrixTransform;
@@ -645,6 +911,7 @@ osg::MatrixTransform *OSGWidget::shape_setup(osg::ShapeDrawable *sd, osg::Vec3 t
 
 void OSGWidget::go_home()
 {
+    QMutexLocker lock(&mSceneMutex);
     osgViewer::ViewerBase::Views views;
     mViewer->getViews( views );
 
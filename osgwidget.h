@@ -15,17 +15,44 @@
 #define MEEN_570_OSGWIDGET
 
 #include <QOpenGLWidget>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
 #include <osg/ref_ptr>
 #include <osgViewer/GraphicsWindow>
 #include <osgViewer/CompositeViewer>
 #include <osgGA/TrackballManipulator>
 #include <osgText/Text>
 #include <map>
+#include <vector>
 #include <osg/Geode>
 #include "joint.h"
+#include "collision.h"
+#include "selfcollision.h"
+#include "sphereinstancer.h"
+#include "statecache.h"
+#include "lod.h"
+#include "renderthread.h"
+#include "sceneregistry.h"
+#include "renderstats.h"
 #include <osg/ShapeDrawable>
 
 
+//How the joint transforms are arranged. Flat joints each hold their world
+//matrix, so an edit rewrites every matrix after it. Nested joints hang from
+//the end frame of the joint before them, so an edit touches one matrix, but
+//traversal depth grows with the chain.
+enum JointLayout
+{
+    LAYOUT_AUTO,
+    LAYOUT_FLAT,
+    LAYOUT_NESTED
+};
+
+//LAYOUT_AUTO nests chains up to this many joints
+const std::size_t NESTED_JOINT_LIMIT = 256;
+
 class OSGWidget : public QOpenGLWidget
 {
   Q_OBJECT
@@ -39,21 +66,60 @@ public:
   osg::MatrixTransform* create_ellipsoid(osg::Vec3 size, osg::Vec3 translation, osg::Vec3 rotation, osg::Vec3 color);
   osg::MatrixTransform* create_cone(osg::Vec3 size, osg::Vec3 translation, osg::Vec3 rotation, osg::Vec3 color);
   osg::MatrixTransform* shape_setup(osg::ShapeDrawable* sd, osg::Vec3 translation, osg::Vec3 rotation, osg::Vec3 color);
-  bool removeShape(int id);
+  //Removes the most recently created shape
+  bool removeShape();
   osg::Geode* draw_joint (Joint *joint);
-  void create_arm (std::list<Joint *> &list);
-  void joint_color (int i, Joint* joint);
-  void open_arm (std::list<Joint *> &list);
-  void erase_joint(int i, std::list<Joint *> &list);
-  void change_joint_config(int i, std::list<Joint *> &list);
+  void create_arm (JointStore &joints);
+  void joint_color (int i, JointStore &joints);
+  void open_arm (JointStore &joints);
+  void erase_joint(int i, JointStore &joints);
+  void change_joint_config(int i, JointStore &joints);
+  void change_joints_config(const std::vector<std::size_t> &changed, JointStore &joints);
   void view_floor(bool view);
   void select_joint(int i,bool selected);
   void reset();
   void drawAxis(bool show);
-  void update_joint_size(Joint* joint, double h, double rad);
+  void update_joint_size(int i, JointStore &joints, double h, double rad);
   void create_shape(QString shape, osg::Vec3 size, osg::Vec3 translation, osg::Vec3 rotation, osg::Vec3 color);
-  void set_starting_pose(osg::MatrixTransform *transform);
-  osg::MatrixTransform* output_matrix(int i, std::list<Joint*> &list);
+  void set_starting_pose(osg::MatrixTransform *transform, JointStore &joints);
+  osg::MatrixTransform* output_matrix(int i, JointStore &joints);
+  bool check_collisions();
+  const std::vector<Contact> &contacts() const;
+  //Distinct StateSets in the scene graph
+  std::size_t unique_states();
+  const std::vector<SelfContact> &self_contacts() const;
+  //Shortest time between two frames, requests inside it are merged into one frame
+  void set_frame_budget(double ms);
+  double frame_budget() const;
+  //Time spent in the last frame, and frames that took longer than the budget
+  double frame_time() const;
+  int frames_over_budget() const;
+  //Runs the viewer on its own thread instead of the GUI thread. Experimental,
+  //only the bench turns it on until render_frame and gui_gap show a gain.
+  void set_render_thread(bool on);
+  bool render_thread() const;
+  //Per-frame timings and counts, recorded while render_stats().recording()
+  RenderStats &render_stats();
+  void set_joint_layout(JointLayout layout, JointStore &joints);
+  bool nested_joints() const;
+
+public slots:
+  //Marks the view dirty, it is drawn once at the next frame slot
+  void request_redraw();
+
+private slots:
+  void redraw();
+  void grab_context();
+  void frame_rendered(double ms, bool more);
+  void lock_scene();
+  void unlock_scene();
+  void lock_draw();
+  void unlock_draw();
+
+signals:
+  void collisions_checked(int contacts, int self_contacts, double max_depth, double query_ms);
+  //After every frame, on the GUI thread, whichever thread drew it
+  void frame_drawn();
 
 protected:
 
@@ -73,16 +139,63 @@ protected:
 private:
   virtual void go_home();
   virtual void on_resize( int width, int height );
+  void update_spheres(JointStore &joints);
+  osg::MatrixTransform* joint_transform(std::size_t i) const;
+  bool use_nested(std::size_t joints) const;
+  void attach_joint(std::size_t i, JointStore &joints);
+  void detach_joint(std::size_t i);
+  void relayout(JointStore &joints);
+  osg::Node* lod_cylinder(double rad, const osg::Vec4 &color, const std::string &name);
   int currentID{0};
-  int mOffset{0};
+  //Redraw scheduling
+  QTimer mRedrawTimer;
+  QElapsedTimer mFrameClock;
+  double mFrameBudget{1000.0/60};
+  double mFrameTime{0};
+  int mFramesOverBudget{0};
+  RenderStats mRenderStats;
+  //Set while a frame is on the render thread, and whether another was asked for meanwhile
+  bool mFramePending{false};
+  bool mRedrawAfterFrame{false};
+
+  //Held by the render thread through update and cull, and here while the scene graph changes
+  QMutex mSceneMutex{QMutex::Recursive};
+  //Held by the render thread while it draws, and here while Qt composes or resizes
+  //and while nodes are removed or drawables change in place. Taken after mSceneMutex.
+  QMutex mDrawMutex{QMutex::Recursive};
+  QThread* mRenderQThread{nullptr};
+  RenderThread* mRenderer{nullptr};
+  int mHighlight{-1};
   bool mFloor{false};
-  osg::MatrixTransform* mStarting_pose = new osg::MatrixTransform;
+
+  //Scene graph nodes of each joint, their transforms and registry handles, in chain order,
+  //and the cached world frames. Nested joints after the first have no handle.
+  std::vector<Joint*> mJointNodes;
+  std::vector<osg::ref_ptr<osg::MatrixTransform> > mJointTransforms;
+  std::vector<SceneHandle> mJointHandles;
+  JointLayout mLayout{LAYOUT_AUTO};
+  bool mNested{true};
+  FrameCache mFrames;
+
+  //Obstacles mirror the shapes, newest last, so removeShape pops the back of both
+  CollisionWorld mObstacles;
+  std::vector<int> mObstacleIds;
+  std::vector<SceneHandle> mShapeHandles;
+  SceneHandle mFloorHandle{INVALID_SCENE_HANDLE};
+  SceneHandle mAxisHandle{INVALID_SCENE_HANDLE};
+  std::vector<CollisionSphere> mSpheres;
+  std::vector<Contact> mContacts;
+  SelfCollision mSelfCollision;
+  std::vector<SelfContact> mSelfContacts;
 
   osgGA::EventQueue* getEventQueue() const;
 
   osg::ref_ptr<osgViewer::GraphicsWindowEmbedded> mGraphicsWindow;
   osg::ref_ptr<osgViewer::CompositeViewer> mViewer;
-  osg::ref_ptr<osg::Group> mRoot;
+  StateCache mStateCache;
+  osg::ref_ptr<osg::Group> mScene;
+  SceneRegistry mRegistry;
+  osg::ref_ptr<SphereInstancer> mSphereInstancer;
   osg::ref_ptr<osgGA::TrackballManipulator> mManipulator;
   std::map<int, osg::MatrixTransform*> mShapeLookup;
   std::map<Joint*, osg::Geode*> mGeodeLookup;
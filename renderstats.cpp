@@ -0,0 +1,234 @@
+//-------------------------------------------------------
+// Filename: renderstats.cpp
+//
+// Description: Records the viewer's per-frame timings and
+//              scene counts into a ring buffer, and exports
+//              them with percentile summaries.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "renderstats.h"
+#include <QFile>
+#include <QTextStream>
+#include <osg/Camera>
+#include <osg/Stats>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const char *FIELD_NAMES[STAT_FIELD_COUNT] = {
+    "event_ms", "update_ms", "cull_ms", "draw_ms", "frame_ms", "draw_calls", "primitives", "vertices"
+};
+
+//Primitive counts the cull traversal reports per GL mode
+const char *PRIMITIVE_ATTRIBUTES[] = {
+    "Visible number of GL_POINTS",
+    "Visible number of GL_LINES",
+    "Visible number of GL_LINE_STRIP",
+    "Visible number of GL_LINE_LOOP",
+    "Visible number of GL_TRIANGLES",
+    "Visible number of GL_TRIANGLE_STRIP",
+    "Visible number of GL_TRIANGLE_FAN",
+    "Visible number of GL_QUADS",
+    "Visible number of GL_QUAD_STRIP",
+    "Visible number of GL_POLYGON"
+};
+
+double attribute(osg::Stats *stats, unsigned int frame, const char *name)
+{
+    double value = 0;
+    if (stats)
+        stats->getAttribute(frame, name, value);
+    return value;
+}
+
+//Seconds in the stats, milliseconds here
+double time_attribute(osg::Stats *stats, unsigned int frame, const char *name)
+{
+    return 1000*attribute(stats, frame, name);
+}
+
+}
+
+RenderStats::RenderStats(std::size_t capacity):
+    mFrames(std::max<std::size_t>(capacity, 1)),
+    mNext{0},
+    mSize{0},
+    mRecording{false},
+    mLastFrame{~0u}
+{}
+
+void RenderStats::set_recording(bool on)
+{
+    mRecording = on;
+}
+
+bool RenderStats::recording() const
+{
+    return mRecording;
+}
+
+void RenderStats::sample(osgViewer::ViewerBase *viewer, double frame_ms)
+{
+    if (!mRecording)
+        return;
+
+    osg::Stats *viewer_stats = viewer->getViewerStats();
+    osgViewer::ViewerBase::Cameras cameras;
+    viewer->getCameras(cameras);
+    if (viewer_stats)
+    {
+        viewer_stats->collectStats("event", true);
+        viewer_stats->collectStats("update", true);
+    }
+    for (std::size_t c = 0; c < cameras.size(); c++)
+    {
+        //Cameras set up by hand have no stats until something gives them one
+        if (!cameras[c]->getStats())
+            cameras[c]->setStats(new osg::Stats("Camera"));
+        cameras[c]->getStats()->collectStats("rendering", true);
+        cameras[c]->getStats()->collectStats("scene", true);
+    }
+    if (!viewer_stats)
+        return;
+
+    //The first frame after switching on has nothing collected yet
+    unsigned int frame = viewer_stats->getLatestFrameNumber();
+    double update = 0;
+    if (frame == mLastFrame || !viewer_stats->getAttribute(frame, "Update traversal time taken", update))
+    {
+        mLastFrame = frame;
+        return;
+    }
+    mLastFrame = frame;
+
+    FrameStats &s = mFrames[mNext];
+    s.frame = frame;
+    s.event_ms = time_attribute(viewer_stats, frame, "Event traversal time taken");
+    s.update_ms = time_attribute(viewer_stats, frame, "Update traversal time taken");
+    s.frame_ms = frame_ms;
+    s.cull_ms = s.draw_ms = s.draw_calls = s.primitives = s.vertices = 0;
+    for (std::size_t c = 0; c < cameras.size(); c++)
+    {
+        osg::Stats *stats = cameras[c]->getStats();
+        s.cull_ms += time_attribute(stats, frame, "Cull traversal time taken");
+        s.draw_ms += time_attribute(stats, frame, "Draw traversal time taken");
+        s.draw_calls += attribute(stats, frame, "Visible number of drawables");
+        s.vertices += attribute(stats, frame, "Visible vertex count");
+        for (std::size_t k = 0; k < sizeof(PRIMITIVE_ATTRIBUTES)/sizeof(PRIMITIVE_ATTRIBUTES[0]); k++)
+            s.primitives += attribute(stats, frame, PRIMITIVE_ATTRIBUTES[k]);
+    }
+
+    mNext = (mNext+1) % mFrames.size();
+    mSize = std::min(mSize+1, mFrames.size());
+}
+
+std::size_t RenderStats::size() const
+{
+    return mSize;
+}
+
+const FrameStats &RenderStats::at(std::size_t i) const
+{
+    //The oldest frame is at mNext once the buffer has wrapped
+    std::size_t first = (mSize == mFrames.size()) ? mNext : 0;
+    return mFrames[(first+i) % mFrames.size()];
+}
+
+void RenderStats::clear()
+{
+    mNext = 0;
+    mSize = 0;
+    mLastFrame = ~0u;
+}
+
+const char *RenderStats::field_name(FrameStatsField field)
+{
+    return FIELD_NAMES[field];
+}
+
+double RenderStats::field(const FrameStats &stats, FrameStatsField field)
+{
+    switch (field)
+    {
+    case STAT_EVENT:
+        return stats.event_ms;
+    case STAT_UPDATE:
+        return stats.update_ms;
+    case STAT_CULL:
+        return stats.cull_ms;
+    case STAT_DRAW:
+        return stats.draw_ms;
+    case STAT_FRAME:
+        return stats.frame_ms;
+    case STAT_DRAW_CALLS:
+        return stats.draw_calls;
+    case STAT_PRIMITIVES:
+        return stats.primitives;
+    case STAT_VERTICES:
+        return stats.vertices;
+    default:
+        return 0;
+    }
+}
+
+double RenderStats::percentile(FrameStatsField field, double p) const
+{
+    if (mSize == 0)
+        return 0;
+    std::vector<double> values(mSize);
+    for (std::size_t i = 0; i < mSize; i++)
+        values[i] = RenderStats::field(at(i), field);
+
+    //Nearest rank: the smallest value with at least p percent of the values at or below it
+    std::size_t rank = static_cast<std::size_t>(std::ceil(p/100*mSize));
+    rank = std::min(std::max<std::size_t>(rank, 1), mSize);
+    std::nth_element(values.begin(), values.begin()+rank-1, values.end());
+    return values[rank-1];
+}
+
+bool RenderStats::write_csv(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+        return false;
+    QTextStream out(&file);
+    out << "frame";
+    for (int f = 0; f < STAT_FIELD_COUNT; f++)
+        out << "," << FIELD_NAMES[f];
+    out << "\n";
+    for (std::size_t i = 0; i < mSize; i++)
+    {
+        const FrameStats &s = at(i);
+        out << s.frame;
+        for (int f = 0; f < STAT_FIELD_COUNT; f++)
+            out << "," << field(s, static_cast<FrameStatsField>(f));
+        out << "\n";
+    }
+    out.flush();
+    return file.error() == QFile::NoError;
+}
+
+bool RenderStats::write_summary_csv(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+        return false;
+    QTextStream out(&file);
+    out << "field,count,mean,p50,p95,p99,max\n";
+    for (int f = 0; f < STAT_FIELD_COUNT; f++)
+    {
+        FrameStatsField which = static_cast<FrameStatsField>(f);
+        double total = 0;
+        for (std::size_t i = 0; i < mSize; i++)
+            total += field(at(i), which);
+        out << FIELD_NAMES[f] << "," << mSize << "," << (mSize ? total/mSize : 0) << ","
+            << percentile(which, 50) << "," << percentile(which, 95) << "," << percentile(which, 99) << ","
+            << percentile(which, 100) << "\n";
+    }
+    out.flush();
+    return file.error() == QFile::NoError;
+}
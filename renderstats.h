@@ -0,0 +1,83 @@
+//-------------------------------------------------------
+// Filename: renderstats.h
+//
+// Description: Records the viewer's per-frame timings and
+//              scene counts into a ring buffer, and exports
+//              them with percentile summaries.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <QString>
+#include <vector>
+#include <osgViewer/ViewerBase>
+
+struct FrameStats
+{
+    unsigned int frame;
+    double event_ms;
+    double update_ms;
+    double cull_ms;
+    double draw_ms;
+    //Wall time of the whole frame, as measured by the widget
+    double frame_ms;
+    //Drawables and primitives that passed culling. An instanced draw counts
+    //once, with the primitives of a single instance.
+    double draw_calls;
+    double primitives;
+    double vertices;
+};
+
+enum FrameStatsField
+{
+    STAT_EVENT,
+    STAT_UPDATE,
+    STAT_CULL,
+    STAT_DRAW,
+    STAT_FRAME,
+    STAT_DRAW_CALLS,
+    STAT_PRIMITIVES,
+    STAT_VERTICES,
+    STAT_FIELD_COUNT
+};
+
+//Reads the same osg::Stats the StatsHandler overlay shows. While recording,
+//the stats it needs are kept switched on, since the overlay switches them
+//off again when it is hidden.
+class RenderStats
+{
+public:
+    explicit RenderStats(std::size_t capacity = 4096);
+    void set_recording(bool on);
+    bool recording() const;
+    //Reads the latest frame of the viewer, if recording
+    void sample(osgViewer::ViewerBase *viewer, double frame_ms);
+
+    //Frames held, oldest first. Once full the oldest are overwritten.
+    std::size_t size() const;
+    const FrameStats &at(std::size_t i) const;
+    void clear();
+
+    static const char *field_name(FrameStatsField field);
+    static double field(const FrameStats &stats, FrameStatsField field);
+    //Nearest-rank percentile, p in [0, 100]
+    double percentile(FrameStatsField field, double p) const;
+
+    //One row per frame
+    bool write_csv(const QString &path) const;
+    //One row per field: count, mean, p50, p95, p99, max
+    bool write_summary_csv(const QString &path) const;
+
+private:
+    std::vector<FrameStats> mFrames;
+    std::size_t mNext;
+    std::size_t mSize;
+    bool mRecording;
+    unsigned int mLastFrame;
+};
+
+#endif // RENDERSTATS_H
@@ -0,0 +1,136 @@
+//-------------------------------------------------------
+// Filename: renderthread.cpp
+//
+// Description: Runs the viewer frames of an OpenGL widget
+//              on their own thread, so a slow frame does
+//              not block the user interface.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "renderthread.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+#include <QThread>
+
+namespace {
+
+//The camera's initial draw callback runs after the cull of the frame
+class CullDone : public osg::Camera::DrawCallback
+{
+public:
+    explicit CullDone(RenderThread *thread):
+        mThread{thread}
+    {}
+
+    virtual void operator()(osg::RenderInfo &) const
+    {
+        mThread->cull_done();
+    }
+
+private:
+    RenderThread *mThread;
+};
+
+}
+
+RenderThread::RenderThread(QOpenGLWidget *widget, osgViewer::ViewerBase *viewer, osg::Camera *camera, QMutex *scene, QMutex *draw):
+    mWidget{widget},
+    mViewer{viewer},
+    mCamera{camera},
+    mScene{scene},
+    mDraw{draw},
+    mSceneHeld{false},
+    mMore{false},
+    mWanted{false},
+    mGranted{false},
+    mExiting{false}
+{
+    mCamera->setInitialDrawCallback(new CullDone(this));
+}
+
+RenderThread::~RenderThread()
+{
+    mCamera->setInitialDrawCallback(nullptr);
+}
+
+void RenderThread::grab_context(QThread *thread)
+{
+    QMutexLocker draw(mDraw);
+    QMutexLocker grab(&mGrabMutex);
+    //A request left over from before an exit, or already answered
+    if (mExiting || !mWanted)
+        return;
+    mWidget->context()->moveToThread(thread);
+    mWanted = false;
+    mGranted = true;
+    mGrabCondition.wakeAll();
+}
+
+void RenderThread::prepare_exit()
+{
+    QMutexLocker grab(&mGrabMutex);
+    mExiting = true;
+    mGrabCondition.wakeAll();
+}
+
+void RenderThread::cull_done()
+{
+    //Also reached from frames drawn on the widget's thread, which hold neither
+    if (!mSceneHeld)
+        return;
+    mMore = mViewer->checkNeedToDoFrame();
+    mDraw->lock();
+    mScene->unlock();
+    mSceneHeld = false;
+}
+
+void RenderThread::render()
+{
+    TRACE_SCOPE("render_thread_frame");
+    QOpenGLContext *context = mWidget->context();
+    if (!context)
+        return;
+
+    //A context can only be moved by the thread that has it, so ask the widget
+    mGrabMutex.lock();
+    if (mExiting)
+    {
+        mGrabMutex.unlock();
+        return;
+    }
+    mWanted = true;
+    emit context_wanted();
+    while (!mGranted && !mExiting)
+        mGrabCondition.wait(&mGrabMutex);
+    bool granted = mGranted;
+    mGranted = false;
+    bool exiting = mExiting;
+    mGrabMutex.unlock();
+
+    if (exiting)
+    {
+        if (granted)
+            context->moveToThread(qApp->thread());
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    mScene->lock();
+    mSceneHeld = true;
+    mWidget->makeCurrent();
+    mViewer->frame();
+    //A frame that culled the camera away never started drawing
+    if (mSceneHeld)
+        cull_done();
+    mWidget->doneCurrent();
+    context->moveToThread(qApp->thread());
+    double ms = clock.nsecsElapsed()/1e6;
+    mDraw->unlock();
+
+    emit frame_rendered(ms, mMore);
+}
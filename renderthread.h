@@ -0,0 +1,72 @@
+//-------------------------------------------------------
+// Filename: renderthread.h
+//
+// Description: Runs the viewer frames of an OpenGL widget
+//              on their own thread, so a slow frame does
+//              not block the user interface.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QObject>
+#include <QMutex>
+#include <QOpenGLWidget>
+#include <QWaitCondition>
+#include <osg/Camera>
+#include <osgViewer/ViewerBase>
+
+//Lives on its own QThread. For every frame the widget's context is moved to
+//that thread, the viewer does its update, cull and draw into the widget's
+//framebuffer, and the context is moved back so Qt can compose it.
+//
+//The scene mutex is held through the update and the cull, and let go once
+//the camera starts drawing, so edits to the scene graph only wait for those.
+//The draw mutex is held from then until the context is back. The widget
+//holds it while it composes or resizes, and while it removes nodes or changes
+//drawables in place, since the draw still reads those.
+class RenderThread : public QObject
+{
+    Q_OBJECT
+
+public:
+    RenderThread(QOpenGLWidget *widget, osgViewer::ViewerBase *viewer, osg::Camera *camera, QMutex *scene, QMutex *draw);
+    ~RenderThread();
+    //Called on the widget's thread when render asks for the context
+    void grab_context(QThread *thread);
+    //Makes a pending or later render return without drawing
+    void prepare_exit();
+    //Called on the render thread when the camera starts drawing
+    void cull_done();
+
+public slots:
+    void render();
+
+signals:
+    //Queued to the widget, which must hand over its context with grab_context
+    void context_wanted();
+    //Frame time in milliseconds, and whether the viewer wants another frame
+    void frame_rendered(double ms, bool more);
+
+private:
+    QOpenGLWidget *mWidget;
+    osgViewer::ViewerBase *mViewer;
+    osg::ref_ptr<osg::Camera> mCamera;
+    QMutex *mScene;
+    QMutex *mDraw;
+    //Set while render holds the scene mutex
+    bool mSceneHeld;
+    //Whether the viewer wanted another frame when the cull was done
+    bool mMore;
+
+    QMutex mGrabMutex;
+    QWaitCondition mGrabCondition;
+    bool mWanted;
+    bool mGranted;
+    bool mExiting;
+};
+
+#endif // RENDERTHREAD_H
@@ -0,0 +1,93 @@
+//-------------------------------------------------------
+// Filename: sceneregistry.cpp
+//
+// Description: Owns the top of the scene graph. Nodes are
+//              kept in one group per layer and addressed
+//              by stable handles, so adding and removing
+//              them never shifts the others.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "sceneregistry.h"
+
+SceneRegistry::SceneRegistry():
+    mRoot{new osg::Group}
+{
+    for (int l = 0; l < SCENE_LAYER_COUNT; l++)
+    {
+        mLayers[l] = new osg::Group;
+        mRoot->addChild(mLayers[l].get());
+    }
+}
+
+osg::Group *SceneRegistry::root() const
+{
+    return mRoot.get();
+}
+
+SceneHandle SceneRegistry::add(SceneLayer layer, osg::Node *node)
+{
+    SceneHandle handle = static_cast<SceneHandle>(mIndex.size());
+    mIndex.push_back(static_cast<int>(mHandle[layer].size()));
+    mLayer.push_back(layer);
+    mHandle[layer].push_back(handle);
+    mLayers[layer]->addChild(node);
+    return handle;
+}
+
+bool SceneRegistry::remove(SceneHandle handle)
+{
+    if (!valid(handle))
+        return false;
+
+    int layer = mLayer[handle];
+    std::size_t i = mIndex[handle];
+    std::size_t last = mHandle[layer].size()-1;
+    osg::Group *group = mLayers[layer].get();
+
+    //Move the last node of the layer into the hole, then drop the end
+    if (i != last)
+    {
+        group->setChild(i, group->getChild(last));
+        mHandle[layer][i] = mHandle[layer][last];
+        mIndex[mHandle[layer][i]] = static_cast<int>(i);
+    }
+    group->removeChildren(last, 1);
+    mHandle[layer].pop_back();
+    mIndex[handle] = -1;
+    return true;
+}
+
+osg::Node *SceneRegistry::node(SceneHandle handle) const
+{
+    if (!valid(handle))
+        return 0;
+    return mLayers[mLayer[handle]]->getChild(mIndex[handle]);
+}
+
+bool SceneRegistry::valid(SceneHandle handle) const
+{
+    return handle < mIndex.size() && mIndex[handle] >= 0;
+}
+
+std::size_t SceneRegistry::size(SceneLayer layer) const
+{
+    return mHandle[layer].size();
+}
+
+void SceneRegistry::clear(SceneLayer layer)
+{
+    //Handles are never reused, so old ones stay invalid
+    for (std::size_t k = 0; k < mHandle[layer].size(); k++)
+        mIndex[mHandle[layer][k]] = -1;
+    mHandle[layer].clear();
+    mLayers[layer]->removeChildren(0, mLayers[layer]->getNumChildren());
+}
+
+void SceneRegistry::clear()
+{
+    for (int l = 0; l < SCENE_LAYER_COUNT; l++)
+        clear(static_cast<SceneLayer>(l));
+}
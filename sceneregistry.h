@@ -0,0 +1,63 @@
+//-------------------------------------------------------
+// Filename: sceneregistry.h
+//
+// Description: Owns the top of the scene graph. Nodes are
+//              kept in one group per layer and addressed
+//              by stable handles, so adding and removing
+//              them never shifts the others.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef SCENEREGISTRY_H
+#define SCENEREGISTRY_H
+
+#include <cstddef>
+#include <vector>
+#include <osg/Group>
+#include <osg/ref_ptr>
+
+typedef unsigned int SceneHandle;
+const SceneHandle INVALID_SCENE_HANDLE = ~0u;
+
+enum SceneLayer
+{
+    LAYER_FLOOR,
+    LAYER_AXIS,
+    LAYER_SHAPES,
+    LAYER_JOINTS,
+    SCENE_LAYER_COUNT
+};
+
+//Order within a layer is not kept: removing a node moves the last node of
+//its layer into its place, so add, remove and lookup are all O(1).
+class SceneRegistry
+{
+public:
+    SceneRegistry();
+    //Holds one group per layer, in SceneLayer order
+    osg::Group *root() const;
+
+    SceneHandle add(SceneLayer layer, osg::Node *node);
+    //Returns false if the handle was already removed
+    bool remove(SceneHandle handle);
+    //Null once the handle has been removed
+    osg::Node *node(SceneHandle handle) const;
+    bool valid(SceneHandle handle) const;
+
+    std::size_t size(SceneLayer layer) const;
+    void clear(SceneLayer layer);
+    void clear();
+
+private:
+    osg::ref_ptr<osg::Group> mRoot;
+    osg::ref_ptr<osg::Group> mLayers[SCENE_LAYER_COUNT];
+
+    //Position in a layer -> handle, and handle -> layer and position
+    std::vector<SceneHandle> mHandle[SCENE_LAYER_COUNT];
+    std::vector<int> mLayer;
+    std::vector<int> mIndex;
+};
+
+#endif // SCENEREGISTRY_H
@@ -0,0 +1,154 @@
+//-------------------------------------------------------
+// Filename: selfcollision.cpp
+//
+// Description: Self-collision checking of the chain's
+//              spheres with a uniform spatial hash.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "selfcollision.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+const int KEY_BITS = 21;
+const std::int64_t KEY_OFFSET = std::int64_t(1) << (KEY_BITS-1);
+
+std::uint64_t pack(std::int64_t ix, std::int64_t iy, std::int64_t iz)
+{
+    ix = std::max(-KEY_OFFSET, std::min(KEY_OFFSET-1, ix)) + KEY_OFFSET;
+    iy = std::max(-KEY_OFFSET, std::min(KEY_OFFSET-1, iy)) + KEY_OFFSET;
+    iz = std::max(-KEY_OFFSET, std::min(KEY_OFFSET-1, iz)) + KEY_OFFSET;
+    return (std::uint64_t(ix) << (2*KEY_BITS)) | (std::uint64_t(iy) << KEY_BITS) | std::uint64_t(iz);
+}
+
+//Half of the 26 neighbours, so each pair of cells is visited once
+const int FORWARD[13][3] = {
+    {1, 0, 0}, {-1, 1, 0}, {0, 1, 0}, {1, 1, 0},
+    {-1, -1, 1}, {0, -1, 1}, {1, -1, 1},
+    {-1, 0, 1}, {0, 0, 1}, {1, 0, 1},
+    {-1, 1, 1}, {0, 1, 1}, {1, 1, 1}
+};
+
+typedef std::pair<std::uint64_t, std::size_t> CellEntry;
+
+bool key_less(const CellEntry &a, std::uint64_t key)
+{
+    return a.first < key;
+}
+
+}
+
+SelfCollision::SelfCollision(std::size_t skip):
+    mSkip{skip}
+{}
+
+void SelfCollision::set_skip(std::size_t skip)
+{
+    mSkip = skip;
+}
+
+std::size_t SelfCollision::skip() const
+{
+    return mSkip;
+}
+
+const SelfCollisionStats &SelfCollision::stats() const
+{
+    return mStats;
+}
+
+void SelfCollision::test_pair(const std::vector<CollisionSphere> &spheres, std::size_t i, std::size_t j, std::vector<SelfContact> &contacts)
+{
+    if (i > j)
+        std::swap(i, j);
+    if (j - i <= mSkip)
+        return;
+    mStats.pair_tests++;
+
+    const CollisionSphere &a = spheres[i];
+    const CollisionSphere &b = spheres[j];
+    double dx = a.center[0] - b.center[0];
+    double dy = a.center[1] - b.center[1];
+    double dz = a.center[2] - b.center[2];
+    double reach = a.radius + b.radius;
+    double d2 = dx*dx + dy*dy + dz*dz;
+    if (d2 >= reach*reach)
+        return;
+
+    SelfContact contact;
+    contact.a = i;
+    contact.b = j;
+    contact.depth = reach - std::sqrt(d2);
+    contacts.push_back(contact);
+    mStats.max_depth = std::max(mStats.max_depth, contact.depth);
+}
+
+bool SelfCollision::query(const std::vector<CollisionSphere> &spheres, std::vector<SelfContact> &contacts)
+{
+    TRACE_SCOPE("self_collision_query");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    contacts.clear();
+    mStats.cells = 0;
+    mStats.pair_tests = 0;
+    mStats.max_depth = 0;
+
+    double largest = 0;
+    for (std::size_t k = 0; k < spheres.size(); k++)
+        largest = std::max(largest, spheres[k].radius);
+
+    std::size_t n = spheres.size();
+    if (largest > 0 && n > mSkip+1)
+    {
+        double inv_size = 1.0/(2*largest);
+        mCells.resize(n);
+        for (std::size_t k = 0; k < n; k++)
+        {
+            const double *c = spheres[k].center;
+            mCells[k].first = pack(std::int64_t(std::floor(c[0]*inv_size)),
+                                   std::int64_t(std::floor(c[1]*inv_size)),
+                                   std::int64_t(std::floor(c[2]*inv_size)));
+            mCells[k].second = k;
+        }
+        std::sort(mCells.begin(), mCells.end());
+
+        std::size_t first = 0;
+        while (first < n)
+        {
+            std::uint64_t key = mCells[first].first;
+            std::size_t last = first;
+            while (last < n && mCells[last].first == key)
+                last++;
+            mStats.cells++;
+
+            //Pairs inside the cell
+            for (std::size_t p = first; p < last; p++)
+                for (std::size_t q = p+1; q < last; q++)
+                    test_pair(spheres, mCells[p].second, mCells[q].second, contacts);
+
+            //Pairs with the forward neighbours. Keys are packed z-fastest, so
+            //offsets are added field by field; clamped cells at the edge of
+            //the key range may be skipped, which only matters beyond 1e6 cells.
+            for (int f = 0; f < 13; f++)
+            {
+                std::uint64_t other = key + (std::uint64_t(std::int64_t(FORWARD[f][0])) << (2*KEY_BITS))
+                                          + (std::uint64_t(std::int64_t(FORWARD[f][1])) << KEY_BITS)
+                                          + std::uint64_t(std::int64_t(FORWARD[f][2]));
+                std::vector<CellEntry>::const_iterator it = std::lower_bound(mCells.begin(), mCells.end(), other, key_less);
+                for (; it != mCells.end() && it->first == other; it++)
+                    for (std::size_t p = first; p < last; p++)
+                        test_pair(spheres, mCells[p].second, it->second, contacts);
+            }
+            first = last;
+        }
+    }
+
+    mStats.contacts = contacts.size();
+    mStats.query_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return !contacts.empty();
+}
@@ -0,0 +1,61 @@
+//-------------------------------------------------------
+// Filename: selfcollision.h
+//
+// Description: Self-collision checking of the chain's
+//              spheres with a uniform spatial hash.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef SELFCOLLISION_H
+#define SELFCOLLISION_H
+
+#include <cstdint>
+#include <utility>
+#include "collision.h"
+
+struct SelfContact
+{
+    //Sphere indices, a < b
+    std::size_t a;
+    std::size_t b;
+    double depth;
+};
+
+struct SelfCollisionStats
+{
+    double query_ms{0};
+    std::size_t cells{0};
+    std::size_t pair_tests{0};
+    std::size_t contacts{0};
+    double max_depth{0};
+};
+
+//Spheres are binned into cells twice the largest radius wide, so only
+//spheres in neighbouring cells can touch and the cost grows with the
+//sphere count instead of its square. Neighbouring spheres along the
+//chain always overlap, so pairs less than skip+1 apart in chain order
+//are never reported.
+class SelfCollision
+{
+public:
+    explicit SelfCollision(std::size_t skip = 2);
+    void set_skip(std::size_t skip);
+    std::size_t skip() const;
+
+    //Returns true if any pair of non-adjacent spheres overlap
+    bool query(const std::vector<CollisionSphere> &spheres, std::vector<SelfContact> &contacts);
+    const SelfCollisionStats &stats() const;
+
+protected:
+    std::size_t mSkip;
+    //(cell key, sphere index), sorted by key; kept between queries to reuse its memory
+    std::vector<std::pair<std::uint64_t, std::size_t> > mCells;
+    SelfCollisionStats mStats;
+
+private:
+    void test_pair(const std::vector<CollisionSphere> &spheres, std::size_t i, std::size_t j, std::vector<SelfContact> &contacts);
+};
+
+#endif // SELFCOLLISION_H
@@ -0,0 +1,217 @@
+//-------------------------------------------------------
+// Filename: selfcollision_test.cpp
+//
+// Description: Checks the spatial hash self-collision
+//              query against testing every pair of spheres,
+//              for folded chains, spheres across cell
+//              borders and short chains.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "selfcollision.h"
+#include "testing.h"
+
+namespace {
+
+bool pair_less(const SelfContact &x, const SelfContact &y)
+{
+    return x.a < y.a || (x.a == y.a && x.b < y.b);
+}
+
+void all_pairs(const std::vector<CollisionSphere> &spheres, std::size_t skip, std::vector<SelfContact> &out)
+{
+    out.clear();
+    for (std::size_t i = 0; i < spheres.size(); i++)
+    {
+        for (std::size_t j = i+skip+1; j < spheres.size(); j++)
+        {
+            double d2 = 0;
+            for (int k = 0; k < 3; k++)
+                d2 += (spheres[i].center[k] - spheres[j].center[k])*(spheres[i].center[k] - spheres[j].center[k]);
+            double reach = spheres[i].radius + spheres[j].radius;
+            if (d2 < reach*reach)
+            {
+                SelfContact contact;
+                contact.a = i;
+                contact.b = j;
+                contact.depth = reach - std::sqrt(d2);
+                out.push_back(contact);
+            }
+        }
+    }
+}
+
+//Same pairs and depths as all_pairs, each reported once; returns the number
+//of contacts so callers can tell the case was not empty
+std::size_t check_against_pairs(const std::vector<CollisionSphere> &spheres, std::size_t skip)
+{
+    SelfCollision self(skip);
+    std::vector<SelfContact> contacts;
+    bool any = self.query(spheres, contacts);
+    std::vector<SelfContact> expected;
+    all_pairs(spheres, skip, expected);
+
+    std::sort(contacts.begin(), contacts.end(), pair_less);
+    CHECK(any == !expected.empty());
+    CHECK(self.stats().contacts == contacts.size());
+    if (!CHECK(contacts.size() == expected.size()))
+    {
+        std::printf("  skip %d, %d spheres: %d contacts, %d expected\n", int(skip), int(spheres.size()),
+                    int(contacts.size()), int(expected.size()));
+        return expected.size();
+    }
+    for (std::size_t k = 0; k < contacts.size(); k++)
+    {
+        if (!CHECK(contacts[k].a == expected[k].a && contacts[k].b == expected[k].b))
+            break;
+        CHECK(contacts[k].a < contacts[k].b);
+        CHECK_NEAR(contacts[k].depth, expected[k].depth, 1e-12);
+    }
+    return expected.size();
+}
+
+//Strong bends fold the chain back onto itself; the base is moved so the
+//spheres sit at negative coordinates and straddle many cell borders
+void folded_spheres(std::mt19937 &random, std::size_t n, std::vector<CollisionSphere> &spheres)
+{
+    std::uniform_real_distribution<double> bend(-AXIS_LIMIT, AXIS_LIMIT);
+    std::uniform_real_distribution<double> height(1, 4);
+    std::uniform_real_distribution<double> shift(-60, -20);
+    const double radii[] = {.3, .8, 1.5, 2.5};
+
+    JointStore joints;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        joints.push_back(int(i), height(random), radii[random() % 4]);
+        joints.set_axis(i, bend(random), bend(random));
+    }
+    joints.set_base(translate_frame(shift(random), shift(random), shift(random)));
+    FrameCache frames;
+    chain_spheres(joints, frames, spheres);
+}
+
+void test_folded_chains()
+{
+    std::mt19937 random(10);
+    std::vector<CollisionSphere> spheres;
+    const std::size_t skips[] = {0, 2, 5};
+    for (std::size_t skip : skips)
+    {
+        std::size_t total = 0;
+        for (int chain = 0; chain < 40; chain++)
+        {
+            folded_spheres(random, 10 + random() % 50, spheres);
+            total += check_against_pairs(spheres, skip);
+        }
+        CHECK(total > 0);
+    }
+}
+
+//Pairs of touching spheres on either side of a cell corner at negative
+//coordinates, one pair for each of the 26 directions to a neighbour cell,
+//then pairs that only just touch, so their centers are almost a cell apart
+void test_cell_borders()
+{
+    std::mt19937 random(11);
+    std::uniform_real_distribution<double> jitter(.01, .4);
+    std::uniform_real_distribution<double> around(-1, 1);
+    std::vector<CollisionSphere> spheres;
+    CollisionSphere s;
+    s.radius = 1;
+    s.joint = 0;
+    //Cells are 2 wide, so (-4, -6, -2) is a corner
+    const double corner[3] = {-4, -6, -2};
+    for (int dx = -1; dx <= 1; dx++)
+        for (int dy = -1; dy <= 1; dy++)
+            for (int dz = -1; dz <= 1; dz++)
+            {
+                if (dx == 0 && dy == 0 && dz == 0)
+                    continue;
+                const int dir[3] = {dx, dy, dz};
+                for (int side = -1; side <= 1; side += 2)
+                {
+                    for (int k = 0; k < 3; k++)
+                        s.center[k] = corner[k] + side*dir[k]*jitter(random);
+                    spheres.push_back(s);
+                }
+                double length = std::sqrt(double(dx*dx + dy*dy + dz*dz));
+                for (int sample = 0; sample < 8; sample++)
+                {
+                    double middle[3] = {corner[0] + around(random), corner[1] + around(random), corner[2] + around(random)};
+                    for (int side = -1; side <= 1; side += 2)
+                    {
+                        for (int k = 0; k < 3; k++)
+                            s.center[k] = middle[k] + side*.999*dir[k]/length;
+                        spheres.push_back(s);
+                    }
+                }
+            }
+    //A few small spheres as well, so the cells are sized by the largest one
+    s.radius = .1;
+    for (int k = 0; k < 10; k++)
+    {
+        s.center[0] = corner[0] + jitter(random);
+        s.center[1] = corner[1] - jitter(random);
+        s.center[2] = corner[2] + jitter(random) - .2;
+        spheres.push_back(s);
+    }
+
+    const std::size_t skips[] = {0, 2, 5};
+    for (std::size_t skip : skips)
+        CHECK(check_against_pairs(spheres, skip) > 0);
+}
+
+//Chains with no pair far enough apart to test
+void test_short_chains()
+{
+    CollisionSphere s;
+    s.center[0] = -1;
+    s.center[1] = -1;
+    s.center[2] = -1;
+    s.radius = 1;
+    s.joint = 0;
+    const std::size_t skips[] = {0, 2, 5};
+    for (std::size_t skip : skips)
+    {
+        //All spheres overlap, but only the ends of a skip+2 chain are far enough apart
+        for (std::size_t n = 0; n <= skip+2; n++)
+        {
+            std::vector<CollisionSphere> spheres(n, s);
+            SelfCollision self(skip);
+            std::vector<SelfContact> contacts;
+            bool any = self.query(spheres, contacts);
+            if (n <= skip+1)
+                CHECK(!any && contacts.empty());
+            else
+                CHECK(any && contacts.size() == 1 && contacts[0].a == 0 && contacts[0].b == n-1);
+        }
+    }
+
+    //set_skip takes effect on the next query
+    std::vector<CollisionSphere> spheres(4, s);
+    SelfCollision self(0);
+    std::vector<SelfContact> contacts;
+    self.query(spheres, contacts);
+    CHECK(contacts.size() == 6);
+    self.set_skip(2);
+    CHECK(self.skip() == 2);
+    self.query(spheres, contacts);
+    CHECK(contacts.size() == 1);
+}
+
+}
+
+int main()
+{
+    test_folded_chains();
+    test_cell_borders();
+    test_short_chains();
+    return test_result();
+}
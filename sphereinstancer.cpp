@@ -0,0 +1,271 @@
+//-------------------------------------------------------
+// Filename: sphereinstancer.cpp
+//
+// Description: Draws every collision sphere of the chain
+//              with one instanced draw of a shared mesh
+//              per level of detail.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "sphereinstancer.h"
+#include "lod.h"
+#include <osg/Math>
+#include <osg/NodeCallback>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/StateSet>
+#include <osg/Uniform>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const char *VERTEX_SHADER =
+        "#version 140\n"
+        "#extension GL_ARB_compatibility : enable\n"
+        "uniform samplerBuffer instances;\n"
+        "out vec4 color;\n"
+        "out vec3 normal;\n"
+        "void main()\n"
+        "{\n"
+        "    vec4 sphere = texelFetch(instances, 2*gl_InstanceID);\n"
+        "    color = texelFetch(instances, 2*gl_InstanceID+1);\n"
+        "    normal = normalize(gl_NormalMatrix*gl_Normal);\n"
+        "    gl_Position = gl_ModelViewProjectionMatrix*vec4(sphere.xyz + sphere.w*gl_Vertex.xyz, 1.0);\n"
+        "}\n";
+
+//Headlight, like the default osg::View light
+const char *FRAGMENT_SHADER =
+        "#version 140\n"
+        "#extension GL_ARB_compatibility : enable\n"
+        "in vec4 color;\n"
+        "in vec3 normal;\n"
+        "void main()\n"
+        "{\n"
+        "    float diffuse = max(dot(normalize(normal), vec3(0.0, 0.0, 1.0)), 0.0);\n"
+        "    gl_FragColor = vec4(color.rgb*(0.2 + 0.8*diffuse), color.a);\n"
+        "}\n";
+
+const float SPHERE_GRAY = .5f;
+const float HIGHLIGHT_GRAY = 1.f;
+
+//Texels per instance: (center, radius) then color
+const int TEXELS = 2;
+
+//Pixel size below which each coarser level is used, and per level the
+//mesh (slices, stacks) and how many spheres of a joint share one drawn sphere
+const double LEVEL_PIXELS[SphereInstancer::LEVELS-1] = {48, 16, 6, 2};
+const int LEVEL_SLICES[SphereInstancer::LEVELS] = {24, 14, 8, 6, 6};
+const int LEVEL_STACKS[SphereInstancer::LEVELS] = {16, 10, 6, 4, 4};
+const int LEVEL_STRIDE[SphereInstancer::LEVELS] = {1, 1, 1, 2, 4};
+
+class InstanceCullCallback : public osg::NodeCallback
+{
+public:
+    virtual void operator()(osg::Node *node, osg::NodeVisitor *nv)
+    {
+        osgUtil::CullVisitor *cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+        if (cv)
+            static_cast<SphereInstancer*>(node)->cull(*cv);
+        traverse(node, nv);
+    }
+};
+
+}
+
+SphereInstancer::SphereInstancer():
+    mCount{0},
+    mHighlight{-1},
+    mDirty{false}
+{
+    osg::Program *program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, VERTEX_SHADER));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, FRAGMENT_SHADER));
+
+    osg::StateSet *stateSet = getOrCreateStateSet();
+    stateSet->setAttributeAndModes(program, osg::StateAttribute::ON);
+    stateSet->addUniform(new osg::Uniform("instances", 0));
+    stateSet->setMode(GL_DEPTH_TEST, osg::StateAttribute::ON);
+
+    for (int l = 0; l < LEVELS; l++)
+    {
+        MeshLevel &mesh = mMeshes[l];
+        mesh.capacity = 0;
+        mesh.count = 0;
+        mesh.geometry = new osg::Geometry;
+        //Instanced draws need vertex buffer objects, display lists cannot hold them
+        mesh.geometry->setUseDisplayList(false);
+        mesh.geometry->setUseVertexBufferObjects(true);
+        build_mesh(mesh, LEVEL_SLICES[l], LEVEL_STACKS[l]);
+
+        mesh.buffer = new osg::TextureBuffer;
+        mesh.buffer->setInternalFormat(GL_RGBA32F_ARB);
+        reserve(mesh, 64);
+        mesh.geometry->getOrCreateStateSet()->setTextureAttribute(0, mesh.buffer.get());
+        mesh.geometry->setNodeMask(0);
+        addDrawable(mesh.geometry.get());
+    }
+
+    setCullCallback(new InstanceCullCallback);
+}
+
+SphereInstancer::~SphereInstancer()
+{}
+
+void SphereInstancer::build_mesh(MeshLevel &mesh, int slices, int stacks)
+{
+    //Unit sphere, the shader scales and moves it per instance
+    osg::Vec3Array *vertices = new osg::Vec3Array;
+    for (int i = 0; i <= stacks; i++)
+    {
+        double theta = osg::PI*i/stacks;
+        for (int j = 0; j <= slices; j++)
+        {
+            double phi = 2*osg::PI*j/slices;
+            vertices->push_back(osg::Vec3(std::sin(theta)*std::cos(phi), std::sin(theta)*std::sin(phi), std::cos(theta)));
+        }
+    }
+
+    mesh.elements = new osg::DrawElementsUShort(GL_TRIANGLES);
+    for (int i = 0; i < stacks; i++)
+    {
+        for (int j = 0; j < slices; j++)
+        {
+            unsigned short a = i*(slices+1) + j;
+            unsigned short b = a + slices + 1;
+            mesh.elements->push_back(a);
+            mesh.elements->push_back(b);
+            mesh.elements->push_back(a+1);
+            mesh.elements->push_back(a+1);
+            mesh.elements->push_back(b);
+            mesh.elements->push_back(b+1);
+        }
+    }
+
+    mesh.geometry->setVertexArray(vertices);
+    //On a unit sphere the normal is the vertex
+    mesh.geometry->setNormalArray(vertices, osg::Array::BIND_PER_VERTEX);
+    mesh.geometry->addPrimitiveSet(mesh.elements.get());
+}
+
+void SphereInstancer::reserve(MeshLevel &mesh, std::size_t count)
+{
+    if (count <= mesh.capacity)
+        return;
+    mesh.capacity = std::max(count, 2*mesh.capacity);
+
+    //A new image rather than resizing the old one, so the buffer object is recreated at the new size
+    float *data = new float[4*TEXELS*mesh.capacity]();
+    mesh.instances = new osg::Image;
+    mesh.instances->setImage(TEXELS*mesh.capacity, 1, 1, GL_RGBA32F_ARB, GL_RGBA, GL_FLOAT,
+                             reinterpret_cast<unsigned char*>(data), osg::Image::USE_NEW_DELETE);
+    //Rewritten during cull, so the draw of the previous frame must finish first
+    mesh.instances->setDataVariance(osg::Object::DYNAMIC);
+    mesh.buffer->setImage(mesh.instances.get());
+}
+
+void SphereInstancer::set_spheres(const std::vector<CollisionSphere> &spheres)
+{
+    mCount = spheres.size();
+    mSource.resize(4*mCount);
+    mJoint.resize(mCount);
+    mOrdinal.resize(mCount);
+    //New spheres start at the finest level and settle during the next cull
+    mLevel.resize(mCount, 0);
+
+    mBounds.init();
+    for (std::size_t k = 0; k < mCount; k++)
+    {
+        const CollisionSphere &s = spheres[k];
+        for (int j = 0; j < 3; j++)
+            mSource[4*k+j] = s.center[j];
+        mSource[4*k+3] = s.radius;
+        mJoint[k] = s.joint;
+        mOrdinal[k] = (k > 0 && spheres[k-1].joint == s.joint) ? mOrdinal[k-1]+1 : 0;
+        mBounds.expandBy(osg::BoundingSphere(osg::Vec3(s.center[0], s.center[1], s.center[2]), s.radius));
+    }
+
+    //The meshes' own bounds are the unit sphere, culling needs the instances'
+    for (int l = 0; l < LEVELS; l++)
+    {
+        mMeshes[l].geometry->setInitialBound(mBounds);
+        mMeshes[l].geometry->dirtyBound();
+    }
+    setNodeMask(mCount > 0 ? ~0u : 0);
+    mDirty = true;
+}
+
+void SphereInstancer::set_highlight(int joint)
+{
+    mHighlight = joint;
+    mDirty = true;
+}
+
+std::size_t SphereInstancer::size() const
+{
+    return mCount;
+}
+
+std::size_t SphereInstancer::drawn(int level) const
+{
+    return mMeshes[level].count;
+}
+
+void SphereInstancer::cull(osgUtil::CullVisitor &cv)
+{
+    for (std::size_t k = 0; k < mCount; k++)
+    {
+        const float *s = &mSource[4*k];
+        double pixels = cv.clampedPixelSize(osg::Vec3(s[0], s[1], s[2]), s[3]);
+        int level = lod_level(pixels, mLevel[k], LEVEL_PIXELS, LEVELS-1);
+        if (level != mLevel[k])
+        {
+            mLevel[k] = level;
+            mDirty = true;
+        }
+    }
+    if (mDirty)
+        pack();
+}
+
+void SphereInstancer::pack()
+{
+    for (int l = 0; l < LEVELS; l++)
+        mMeshes[l].count = 0;
+    for (std::size_t k = 0; k < mCount; k++)
+    {
+        if (mOrdinal[k] % LEVEL_STRIDE[mLevel[k]] == 0)
+            mMeshes[mLevel[k]].count++;
+    }
+
+    std::size_t next[LEVELS];
+    for (int l = 0; l < LEVELS; l++)
+    {
+        reserve(mMeshes[l], mMeshes[l].count);
+        next[l] = 0;
+    }
+
+    for (std::size_t k = 0; k < mCount; k++)
+    {
+        int l = mLevel[k];
+        if (mOrdinal[k] % LEVEL_STRIDE[l] != 0)
+            continue;
+        float *texel = reinterpret_cast<float*>(mMeshes[l].instances->data()) + 4*TEXELS*next[l]++;
+        std::copy(&mSource[4*k], &mSource[4*k]+4, texel);
+        float gray = (int(mJoint[k]) == mHighlight) ? HIGHLIGHT_GRAY : SPHERE_GRAY;
+        texel[4] = texel[5] = texel[6] = gray;
+        texel[7] = 1.f;
+    }
+
+    for (int l = 0; l < LEVELS; l++)
+    {
+        MeshLevel &mesh = mMeshes[l];
+        mesh.instances->dirty();
+        mesh.elements->setNumInstances(mesh.count);
+        //With no instances the draw would fall back to a plain, single draw
+        mesh.geometry->setNodeMask(mesh.count > 0 ? ~0u : 0);
+    }
+    mDirty = false;
+}
@@ -0,0 +1,77 @@
+//-------------------------------------------------------
+// Filename: sphereinstancer.h
+//
+// Description: Draws every collision sphere of the chain
+//              with one instanced draw of a shared mesh
+//              per level of detail.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef SPHEREINSTANCER_H
+#define SPHEREINSTANCER_H
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Image>
+#include <osg/TextureBuffer>
+#include <osgUtil/CullVisitor>
+#include <vector>
+#include "collision.h"
+
+//Spheres are given in world coordinates, so this node goes directly
+//under the scene root. Each instance is two texels of a float texture
+//buffer, (center, radius) and color, read in the vertex shader with
+//gl_InstanceID, so moving the chain only rewrites those buffers.
+//
+//During culling every sphere picks a mesh from its size on screen (see
+//lod_level). The smallest levels also draw only every second or fourth
+//sphere of a joint, since they overlap on screen anyway.
+class SphereInstancer : public osg::Geode
+{
+public:
+    SphereInstancer();
+    void set_spheres(const std::vector<CollisionSphere> &spheres);
+    //Spheres of this joint are drawn highlighted, -1 for none
+    void set_highlight(int joint);
+    std::size_t size() const;
+    //Instances drawn at each level in the last frame
+    std::size_t drawn(int level) const;
+
+    void cull(osgUtil::CullVisitor &cv);
+
+    static const int LEVELS = 5;
+
+protected:
+    virtual ~SphereInstancer();
+
+private:
+    struct MeshLevel
+    {
+        osg::ref_ptr<osg::Geometry> geometry;
+        osg::ref_ptr<osg::DrawElementsUShort> elements;
+        osg::ref_ptr<osg::Image> instances;
+        osg::ref_ptr<osg::TextureBuffer> buffer;
+        std::size_t capacity;
+        std::size_t count;
+    };
+
+    void build_mesh(MeshLevel &mesh, int slices, int stacks);
+    void reserve(MeshLevel &mesh, std::size_t count);
+    void pack();
+
+    MeshLevel mMeshes[LEVELS];
+
+    //Per sphere: center and radius, joint, position along the joint, level
+    std::vector<float> mSource;
+    std::vector<std::size_t> mJoint;
+    std::vector<int> mOrdinal;
+    std::vector<int> mLevel;
+    std::size_t mCount;
+    int mHighlight;
+    bool mDirty;
+    osg::BoundingBox mBounds;
+};
+
+#endif // SPHEREINSTANCER_H
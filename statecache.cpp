@@ -0,0 +1,77 @@
+//-------------------------------------------------------
+// Filename: statecache.cpp
+//
+// Description: One shared StateSet per material class,
+//              so OSG does not switch state between
+//              objects that only differ in color.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "statecache.h"
+#include <osg/Material>
+#include <osg/NodeVisitor>
+#include <set>
+
+namespace {
+
+class StateCountVisitor : public osg::NodeVisitor
+{
+public:
+    StateCountVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {}
+
+    //Drawables are nodes too, so this sees their states as well
+    virtual void apply(osg::Node &node)
+    {
+        add(node.getStateSet());
+        traverse(node);
+    }
+
+    std::set<const osg::StateSet*> mStates;
+
+private:
+    void add(const osg::StateSet *state)
+    {
+        if (state)
+            mStates.insert(state);
+    }
+};
+
+}
+
+StateCache::StateCache()
+{}
+
+osg::StateSet *StateCache::get(MaterialClass material)
+{
+    if (mStates[material].valid())
+        return mStates[material].get();
+
+    osg::StateSet *stateSet = new osg::StateSet;
+    switch (material)
+    {
+    case MATERIAL_LIT:
+    default:
+    {
+        //Set material for basic lighting and enable depth tests.
+        osg::Material *m = new osg::Material;
+        m->setColorMode(osg::Material::AMBIENT_AND_DIFFUSE);
+        stateSet->setAttributeAndModes(m, osg::StateAttribute::ON);
+        stateSet->setMode(GL_DEPTH_TEST, osg::StateAttribute::ON);
+        break;
+    }
+    }
+    mStates[material] = stateSet;
+    return stateSet;
+}
+
+std::size_t count_states(osg::Node *node)
+{
+    StateCountVisitor visitor;
+    if (node)
+        node->accept(visitor);
+    return visitor.mStates.size();
+}
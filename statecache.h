@@ -0,0 +1,40 @@
+//-------------------------------------------------------
+// Filename: statecache.h
+//
+// Description: One shared StateSet per material class,
+//              so OSG does not switch state between
+//              objects that only differ in color.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef STATECACHE_H
+#define STATECACHE_H
+
+#include <osg/Node>
+#include <osg/StateSet>
+#include <osg/ref_ptr>
+
+enum MaterialClass
+{
+    //Lit, depth tested, color taken from the drawable's color array
+    MATERIAL_LIT,
+    MATERIAL_CLASS_COUNT
+};
+
+class StateCache
+{
+public:
+    StateCache();
+    //Created on first use, then shared by every caller
+    osg::StateSet *get(MaterialClass material);
+
+private:
+    osg::ref_ptr<osg::StateSet> mStates[MATERIAL_CLASS_COUNT];
+};
+
+//Number of distinct StateSets on the nodes and drawables under node
+std::size_t count_states(osg::Node *node);
+
+#endif // STATECACHE_H
@@ -0,0 +1,56 @@
+//-------------------------------------------------------
+// Filename: testing.h
+//
+// Description: Minimal checks shared by the ctest
+//              executables. A failed check prints where it
+//              failed and the run carries on, main returns
+//              test_result().
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef TESTING_H
+#define TESTING_H
+
+#include <cmath>
+#include <cstdio>
+
+inline int &test_failures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline bool test_check(bool ok, const char *what, const char *file, int line)
+{
+    if (!ok)
+    {
+        std::fprintf(stderr, "%s:%d: failed: %s\n", file, line, what);
+        test_failures()++;
+    }
+    return ok;
+}
+
+inline bool test_near(double a, double b, double tolerance, const char *what, const char *file, int line)
+{
+    if (!(std::fabs(a - b) <= tolerance))
+    {
+        std::fprintf(stderr, "%s:%d: failed: %s (%.17g vs %.17g, tolerance %g)\n", file, line, what, a, b, tolerance);
+        test_failures()++;
+        return false;
+    }
+    return true;
+}
+
+inline int test_result()
+{
+    if (test_failures() > 0)
+        std::fprintf(stderr, "%d checks failed\n", test_failures());
+    return test_failures() > 0 ? 1 : 0;
+}
+
+#define CHECK(cond) test_check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tolerance) test_near((a), (b), (tolerance), #a " ~ " #b, __FILE__, __LINE__)
+
+#endif // TESTING_H
@@ -0,0 +1,189 @@
+//-------------------------------------------------------
+// Filename: trace.cpp
+//
+// Description: Scoped timing spans, recorded per thread
+//              and written out as a Chrome trace JSON
+//              file (chrome://tracing or Perfetto).
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> gTraceEnabled{false};
+
+namespace {
+
+struct TraceEvent
+{
+    const char *name;
+    std::uint64_t start;
+    std::uint64_t end;
+};
+
+//Written only by its own thread. mCount is published with release, so a
+//reader that loads it with acquire sees every event below it.
+struct ThreadBuffer
+{
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<std::size_t> count;
+    std::atomic<std::size_t> dropped;
+    int thread;
+};
+
+//Buffers outlive their threads, so spans of finished threads are still written
+std::mutex &registry_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<ThreadBuffer*> &registry()
+{
+    static std::vector<ThreadBuffer*> buffers;
+    return buffers;
+}
+
+ThreadBuffer *thread_buffer()
+{
+    thread_local ThreadBuffer *buffer = 0;
+    if (!buffer)
+    {
+        buffer = new ThreadBuffer;
+        buffer->events.reset(new TraceEvent[TRACE_BUFFER_EVENTS]);
+        buffer->count = 0;
+        buffer->dropped = 0;
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        buffer->thread = static_cast<int>(registry().size());
+        registry().push_back(buffer);
+    }
+    return buffer;
+}
+
+std::string &environment_path()
+{
+    static std::string path;
+    return path;
+}
+
+void write_escaped(std::FILE *file, const char *text)
+{
+    for (; *text; text++)
+    {
+        if (*text == '"' || *text == '\\')
+            std::fputc('\\', file);
+        std::fputc(*text, file);
+    }
+}
+
+}
+
+void trace_set_enabled(bool on)
+{
+    gTraceEnabled.store(on, std::memory_order_relaxed);
+}
+
+std::uint64_t trace_now()
+{
+    static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void trace_record(const char *name, std::uint64_t start, std::uint64_t end)
+{
+    ThreadBuffer *buffer = thread_buffer();
+    std::size_t n = buffer->count.load(std::memory_order_relaxed);
+    if (n >= TRACE_BUFFER_EVENTS)
+    {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    TraceEvent &event = buffer->events[n];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    buffer->count.store(n+1, std::memory_order_release);
+}
+
+void trace_clear()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    for (std::size_t k = 0; k < registry().size(); k++)
+    {
+        registry()[k]->count.store(0, std::memory_order_release);
+        registry()[k]->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::size_t trace_event_count()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    std::size_t total = 0;
+    for (std::size_t k = 0; k < registry().size(); k++)
+        total += registry()[k]->count.load(std::memory_order_acquire);
+    return total;
+}
+
+std::size_t trace_dropped_count()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    std::size_t total = 0;
+    for (std::size_t k = 0; k < registry().size(); k++)
+        total += registry()[k]->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+bool trace_write(const std::string &path)
+{
+    std::FILE *file = std::fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    //Complete ("X") events, times in microseconds
+    std::fputs("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [", file);
+    bool first = true;
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    for (std::size_t k = 0; k < registry().size(); k++)
+    {
+        const ThreadBuffer *buffer = registry()[k];
+        std::size_t n = buffer->count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const TraceEvent &event = buffer->events[i];
+            std::fputs(first ? "\n" : ",\n", file);
+            first = false;
+            std::fputs("{\"name\": \"", file);
+            write_escaped(file, event.name);
+            std::fprintf(file, "\", \"cat\": \"softrobot\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                         buffer->thread, event.start/1e3, (event.end - event.start)/1e3);
+        }
+    }
+    std::fputs("\n]}\n", file);
+    bool ok = !std::ferror(file);
+    return std::fclose(file) == 0 && ok;
+}
+
+void trace_start_from_environment()
+{
+    const char *path = std::getenv(TRACE_ENVIRONMENT);
+    if (!path || !*path)
+        return;
+    environment_path() = path;
+    trace_set_enabled(true);
+}
+
+void trace_finish_from_environment()
+{
+    if (environment_path().empty())
+        return;
+    trace_set_enabled(false);
+    if (!trace_write(environment_path()))
+        std::fprintf(stderr, "Cannot write trace %s\n", environment_path().c_str());
+}
@@ -0,0 +1,81 @@
+//-------------------------------------------------------
+// Filename: trace.h
+//
+// Description: Scoped timing spans, recorded per thread
+//              and written out as a Chrome trace JSON
+//              file (chrome://tracing or Perfetto).
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//Set from the environment: SOFTROBOT_TRACE=file turns tracing on at startup,
+//and trace_finish writes the file at exit.
+const char *const TRACE_ENVIRONMENT = "SOFTROBOT_TRACE";
+
+//Each thread keeps its own fixed-size buffer, spans past it are dropped
+const std::size_t TRACE_BUFFER_EVENTS = 1 << 18;
+
+extern std::atomic<bool> gTraceEnabled;
+
+inline bool trace_enabled()
+{
+    return gTraceEnabled.load(std::memory_order_relaxed);
+}
+
+void trace_set_enabled(bool on);
+//Nanoseconds since the first call
+std::uint64_t trace_now();
+//name must outlive the trace, in practice a string literal
+void trace_record(const char *name, std::uint64_t start, std::uint64_t end);
+
+//Drops every recorded span. Only call while no traced code is running.
+void trace_clear();
+std::size_t trace_event_count();
+std::size_t trace_dropped_count();
+//Writes every thread's spans as Chrome trace JSON
+bool trace_write(const std::string &path);
+
+//Turns tracing on if TRACE_ENVIRONMENT is set, and writes the file it names
+void trace_start_from_environment();
+void trace_finish_from_environment();
+
+//Records the time from construction to destruction. Costs one relaxed load
+//while tracing is off.
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name):
+        mName{trace_enabled() ? name : 0},
+        mStart{mName ? trace_now() : 0}
+    {}
+    ~TraceScope()
+    {
+        if (mName)
+            trace_record(mName, mStart, trace_now());
+    }
+
+private:
+    TraceScope(const TraceScope &);
+    TraceScope &operator=(const TraceScope &);
+
+    const char *mName;
+    std::uint64_t mStart;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#ifdef SOFTROBOT_NO_TRACE
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#endif
+
+#endif // TRACE_H
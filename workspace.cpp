@@ -0,0 +1,237 @@
+//-------------------------------------------------------
+// Filename: workspace.cpp
+//
+// Description: Monte Carlo sampling of the reachable
+//              workspace of a chain.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "workspace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int KEY_BITS = 21;
+const std::int64_t KEY_OFFSET = std::int64_t(1) << (KEY_BITS-1);
+const std::int64_t KEY_MASK = (std::int64_t(1) << KEY_BITS) - 1;
+
+std::uint64_t pack(std::int64_t ix, std::int64_t iy, std::int64_t iz)
+{
+    ix = std::max(-KEY_OFFSET, std::min(KEY_OFFSET-1, ix)) + KEY_OFFSET;
+    iy = std::max(-KEY_OFFSET, std::min(KEY_OFFSET-1, iy)) + KEY_OFFSET;
+    iz = std::max(-KEY_OFFSET, std::min(KEY_OFFSET-1, iz)) + KEY_OFFSET;
+    return (std::uint64_t(ix) << (2*KEY_BITS)) | (std::uint64_t(iy) << KEY_BITS) | std::uint64_t(iz);
+}
+
+std::int64_t unpack(std::uint64_t key, int axis)
+{
+    return std::int64_t((key >> ((2-axis)*KEY_BITS)) & KEY_MASK) - KEY_OFFSET;
+}
+
+//Samples per block; each block has its own seed
+const std::uint64_t BLOCK = 4096;
+
+//Scratch space for one thread
+struct SampleWorkspace
+{
+    Chain chain;
+    std::vector<Frame> frames;
+    std::vector<double> su;
+    std::vector<double> sv;
+    std::vector<double> ss;
+    std::vector<std::size_t> owner;
+    std::vector<Frame> spheres;
+};
+
+void sample_block(const JointStore &joints, const WorkspaceOptions &options, std::uint64_t block,
+                  SampleWorkspace &ws, VoxelGrid &grid)
+{
+    const Chain &chain = joints.chain();
+    std::size_t n = chain.size();
+    std::uint64_t first = block*BLOCK;
+    std::uint64_t last = std::min(options.samples, first+BLOCK);
+
+    std::mt19937_64 rng(options.seed*0x9E3779B97F4A7C15ULL + block);
+    std::uniform_real_distribution<double> axis(-options.limit, options.limit);
+
+    for (std::uint64_t k = first; k < last; k++)
+    {
+        for (std::size_t i = 0; i < n; i++)
+        {
+            ws.chain.u[i] = axis(rng);
+            ws.chain.v[i] = axis(rng);
+        }
+        forward_kinematics(ws.chain, ws.frames);
+        grid.add(ws.frames[n].t);
+
+        if (!options.include_spheres)
+            continue;
+
+        //Scale each joint's bend to each sphere's arc length and evaluate them in one batch
+        std::size_t m = 0;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            double h = chain.height[i];
+            int count = sphere_count(h, joints.radius()[i]);
+            for (int c = 0; c < count; c++, m++)
+            {
+                double s = sphere_arc_length(h, count, c);
+                ws.su[m] = ws.chain.u[i]*s/h;
+                ws.sv[m] = ws.chain.v[i]*s/h;
+                ws.ss[m] = s;
+            }
+        }
+        arc_transform_batch(ws.su.data(), ws.sv.data(), ws.ss.data(), m, ws.spheres.data());
+        for (std::size_t c = 0; c < m; c++)
+        {
+            const Frame &b = ws.frames[ws.owner[c]];
+            const double *t = ws.spheres[c].t;
+            double p[3];
+            for (int j = 0; j < 3; j++)
+                p[j] = t[0]*b.r[0][j] + t[1]*b.r[1][j] + t[2]*b.r[2][j] + b.t[j];
+            grid.add(p);
+        }
+    }
+}
+
+}
+
+VoxelGrid::VoxelGrid(double voxel_size):
+    mVoxelSize{voxel_size},
+    mInvSize{1.0/voxel_size},
+    mTotal{0}
+{}
+
+double VoxelGrid::voxel_size() const
+{
+    return mVoxelSize;
+}
+
+std::size_t VoxelGrid::size() const
+{
+    return mCells.size();
+}
+
+std::uint64_t VoxelGrid::total() const
+{
+    return mTotal;
+}
+
+void VoxelGrid::add(const double point[3])
+{
+    std::int64_t ix = std::int64_t(std::floor(point[0]*mInvSize));
+    std::int64_t iy = std::int64_t(std::floor(point[1]*mInvSize));
+    std::int64_t iz = std::int64_t(std::floor(point[2]*mInvSize));
+    mCells[pack(ix, iy, iz)]++;
+    mTotal++;
+}
+
+bool VoxelGrid::merge(const VoxelGrid &other)
+{
+    if (other.mVoxelSize != mVoxelSize)
+        return false;
+    for (std::unordered_map<std::uint64_t, std::uint64_t>::const_iterator it = other.mCells.begin(); it != other.mCells.end(); it++)
+        mCells[it->first] += it->second;
+    mTotal += other.mTotal;
+    return true;
+}
+
+void VoxelGrid::clear()
+{
+    mCells.clear();
+    mTotal = 0;
+}
+
+bool VoxelGrid::write(const std::string &filename, std::uint64_t samples) const
+{
+    std::ofstream out(filename.c_str());
+    if (!out)
+        return false;
+
+    std::vector<std::uint64_t> keys;
+    keys.reserve(mCells.size());
+    for (std::unordered_map<std::uint64_t, std::uint64_t>::const_iterator it = mCells.begin(); it != mCells.end(); it++)
+        keys.push_back(it->first);
+    std::sort(keys.begin(), keys.end());
+
+    out << "# soft robot workspace voxel grid\n";
+    out << "# voxel_size " << mVoxelSize << "\n";
+    out << "# samples " << samples << "\n";
+    out << "# points " << mTotal << "\n";
+    out << "# voxel (ix, iy, iz) spans [i*voxel_size, (i+1)*voxel_size)\n";
+    out << "# ix iy iz count\n";
+    for (std::size_t k = 0; k < keys.size(); k++)
+    {
+        out << unpack(keys[k], 0) << " " << unpack(keys[k], 1) << " " << unpack(keys[k], 2) << " "
+            << mCells.find(keys[k])->second << "\n";
+    }
+    return bool(out);
+}
+
+WorkspaceStats sample_workspace(const JointStore &joints, const WorkspaceOptions &options, VoxelGrid &grid)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::uint64_t blocks = (options.samples + BLOCK - 1)/BLOCK;
+
+    unsigned threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > blocks)
+        threads = unsigned(std::max<std::uint64_t>(1, blocks));
+
+    //Each thread bins into its own grid; they are merged at the end
+    std::vector<VoxelGrid> grids(threads, VoxelGrid(grid.voxel_size()));
+    std::atomic<std::uint64_t> next(0);
+    auto worker = [&](unsigned t)
+    {
+        SampleWorkspace ws;
+        ws.chain = joints.chain();
+        std::size_t spheres = 0;
+        for (std::size_t i = 0; i < joints.size(); i++)
+        {
+            int count = sphere_count(joints.chain().height[i], joints.radius()[i]);
+            ws.owner.insert(ws.owner.end(), count, i);
+            spheres += count;
+        }
+        ws.su.resize(spheres);
+        ws.sv.resize(spheres);
+        ws.ss.resize(spheres);
+        ws.spheres.resize(spheres);
+
+        for (;;)
+        {
+            std::uint64_t block = next.fetch_add(1);
+            if (block >= blocks)
+                break;
+            sample_block(joints, options, block, ws, grids[t]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+        pool.push_back(std::thread(worker, t));
+    worker(0);
+    for (std::size_t t = 0; t < pool.size(); t++)
+        pool[t].join();
+
+    std::uint64_t before = grid.total();
+    for (unsigned t = 0; t < threads; t++)
+        grid.merge(grids[t]);
+
+    WorkspaceStats stats;
+    stats.samples = options.samples;
+    stats.points = grid.total() - before;
+    stats.voxels = grid.size();
+    stats.threads = threads;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,70 @@
+//-------------------------------------------------------
+// Filename: workspace.h
+//
+// Description: Monte Carlo sampling of the reachable
+//              workspace of a chain into a sparse voxel
+//              occupancy grid.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "jointstore.h"
+
+//Sparse grid of hit counts. Voxel indices must fit in 21 bits each,
+//so points further than about 1e6 voxels from the origin are clamped.
+class VoxelGrid
+{
+public:
+    explicit VoxelGrid(double voxel_size = 1.0);
+    double voxel_size() const;
+    std::size_t size() const;
+    std::uint64_t total() const;
+    void add(const double point[3]);
+    //Returns false and leaves this grid alone if the voxel sizes differ
+    bool merge(const VoxelGrid &other);
+    void clear();
+    //Text file: a comment header, then one "ix iy iz count" line per voxel
+    bool write(const std::string &filename, std::uint64_t samples) const;
+
+protected:
+    double mVoxelSize;
+    double mInvSize;
+    std::uint64_t mTotal;
+    std::unordered_map<std::uint64_t, std::uint64_t> mCells;
+};
+
+struct WorkspaceOptions
+{
+    std::uint64_t samples{1000000};
+    //Also count the center of every collision sphere, not just the end effector
+    bool include_spheres{true};
+    double limit{AXIS_LIMIT};
+    //0 uses every core
+    unsigned threads{0};
+    std::uint64_t seed{1};
+};
+
+struct WorkspaceStats
+{
+    std::uint64_t samples{0};
+    //Points added by this run, the grid may hold more from earlier runs
+    std::uint64_t points{0};
+    std::size_t voxels{0};
+    double seconds{0};
+    unsigned threads{0};
+};
+
+//Draws every joint's (u, v) uniformly within the limits and adds the points
+//to grid, binned at the grid's own voxel size. Samples are generated and
+//binned in blocks, so memory does not grow with the sample count, and the
+//result does not depend on the thread count.
+WorkspaceStats sample_workspace(const JointStore &joints, const WorkspaceOptions &options, VoxelGrid &grid);
+
+#endif // WORKSPACE_H
@@ -0,0 +1,105 @@
+//-------------------------------------------------------
+// Filename: workspace_test.cpp
+//
+// Description: Checks workspace sampling: binning at the
+//              grid's voxel size, point counts, and the
+//              same grid for any thread count.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "testing.h"
+#include "workspace.h"
+
+namespace {
+
+void make_joints(JointStore &joints)
+{
+    joints.push_back(0, 5, 1);
+    joints.push_back(1, 4, 1);
+    joints.push_back(2, 3, 1);
+}
+
+std::size_t sphere_total(const JointStore &joints)
+{
+    std::size_t spheres = 0;
+    for (std::size_t i = 0; i < joints.size(); i++)
+        spheres += sphere_count(joints.chain().height[i], joints.radius()[i]);
+    return spheres;
+}
+
+std::string read_file(const std::string &filename)
+{
+    std::ifstream in(filename.c_str());
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void test_voxel_size()
+{
+    JointStore joints;
+    make_joints(joints);
+    WorkspaceOptions options;
+    options.samples = 5000;
+    options.threads = 2;
+
+    //Points are binned at the grid's size, and the header says so
+    VoxelGrid fine(0.25);
+    WorkspaceStats stats = sample_workspace(joints, options, fine);
+    CHECK(stats.points == options.samples*(1 + sphere_total(joints)));
+    CHECK(fine.total() == stats.points);
+    VoxelGrid coarse(4);
+    sample_workspace(joints, options, coarse);
+    CHECK(coarse.total() == fine.total());
+    CHECK(coarse.size() < fine.size());
+
+    std::string filename = "workspace_test_grid.txt";
+    CHECK(coarse.write(filename, options.samples));
+    CHECK(read_file(filename).find("# voxel_size 4\n") != std::string::npos);
+    std::remove(filename.c_str());
+
+    //A second run adds to the grid and reports only its own points
+    stats = sample_workspace(joints, options, coarse);
+    CHECK(stats.points == fine.total());
+    CHECK(coarse.total() == 2*fine.total());
+
+    VoxelGrid other(0.5);
+    CHECK(!coarse.merge(other));
+    CHECK(coarse.total() == 2*fine.total());
+}
+
+void test_threads()
+{
+    JointStore joints;
+    make_joints(joints);
+    WorkspaceOptions options;
+    options.samples = 20000;
+
+    options.threads = 1;
+    VoxelGrid one(0.5);
+    sample_workspace(joints, options, one);
+    options.threads = 4;
+    VoxelGrid four(0.5);
+    sample_workspace(joints, options, four);
+
+    std::string a = "workspace_test_1.txt";
+    std::string b = "workspace_test_4.txt";
+    CHECK(one.write(a, options.samples));
+    CHECK(four.write(b, options.samples));
+    CHECK(read_file(a) == read_file(b));
+    std::remove(a.c_str());
+    std::remove(b.c_str());
+}
+
+}
+
+int main()
+{
+    test_voxel_size();
+    test_threads();
+    return test_result();
+}
@@ -0,0 +1,164 @@
+//-------------------------------------------------------
+// Filename: xml_test.cpp
+//
+// Description: Checks that reading a joints file through
+//              XmlLoader gives the same joints and the same
+//              errors as reading it with QXmlStreamReader
+//              alone, for good and malformed files.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <QBuffer>
+#include <QByteArray>
+#include <QFile>
+#include "testing.h"
+#include "xmlreader.h"
+
+namespace {
+
+const char *filename = "xml_test.xml";
+
+bool same_value(double a, double b)
+{
+    return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+bool same_joints(const JointStore &a, const JointStore &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+    {
+        double x[7], y[7];
+        a.get_size(i, x[0], x[1]);
+        a.get_color(i, x[2], x[3], x[4]);
+        a.get_axis(i, x[5], x[6]);
+        b.get_size(i, y[0], y[1]);
+        b.get_color(i, y[2], y[3], y[4]);
+        b.get_axis(i, y[5], y[6]);
+        if (a.get_id(i) != b.get_id(i))
+            return false;
+        for (int k = 0; k < 7; k++)
+        {
+            if (!same_value(x[k], y[k]))
+                return false;
+        }
+    }
+    return true;
+}
+
+//Reads text from a file, which goes through XmlLoader, and from a buffer,
+//which only uses QXmlStreamReader, and checks both agree
+void check_same(const std::string &text)
+{
+    QFile file(filename);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(text.data(), text.size());
+    file.close();
+
+    JointStore loaded;
+    XmlReader loader(loaded);
+    file.open(QIODevice::ReadOnly);
+    bool loaded_ok = loader.read(&file);
+    file.close();
+
+    JointStore read;
+    XmlReader reader(read);
+    QByteArray bytes(text.data(), int(text.size()));
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+    bool read_ok = reader.read(static_cast<QIODevice*>(&buffer));
+
+    bool same = CHECK(loaded_ok == read_ok);
+    if (same && read_ok)
+        same = CHECK(same_joints(loaded, read));
+    else if (same)
+        same = CHECK(loader.errorString() == reader.errorString());
+    if (!same)
+        std::printf("  %s\n  %s\n  %s\n", text.c_str(), qPrintable(loader.errorString()), qPrintable(reader.errorString()));
+}
+
+void test_cases()
+{
+    const char *texts[] = {
+        "<joints><joint><id>1</foo></joint></joints>",
+        "<joints><joint><id>1</id><size><height>1</height><radius>2</radius></size></jointx>",
+        "<joints><joint><id>1</id></joint></joints>trailing <x> </y> & <",
+        "<joints><joint><extra><a></b></extra></joint></joints>",
+        "<joints><joint><size><height>1</height><radius>2</radius></siz></joint></joints>",
+        "<joints><joint><id>1</id ></joint></joints><!-- c -->",
+        "<joints><joint><id>1</id></joint>",
+        "<joints><joint><id a=\"1\">1</id></joint></joints>",
+        "<joints><joint><id>1&amp;</id></joint></joints>",
+        "<?xml version=\"2.0\"?><joints><joint/></joints>",
+        "<?xml version=\"1.0\"?>text<joints><joint/></joints>",
+        "<!DOCTYPE joints><joints><joint/></joints>",
+        "<joints><joint><id>1<x/></id></joint></joints>",
+        "<joints><!-- a -- b --><joint/></joints>",
+        "<joints><joint><id>x</id></joint></joints>",
+        "<joints>\n<joint><color><red>1</red><green>2</green></color></joint>\n</joints>",
+        "<joints><other/></joints>",
+        "<joints/>",
+        "<?xml version=\"1.0\"?>\n<foo/>",
+        "<joints><joint><size><height>1e400</height><radius>1</radius></size></joint></joints>",
+        "<joints><joint><axis><u>inf</u><v>-nan</v></axis></joint></joints>",
+        "<joints>\r\n<joint><id> 2 </id><color><red>1</red><green>.5</green><blue>5.</blue></color></joint>\r\n</joints>"
+    };
+    for (const char *text : texts)
+        check_same(text);
+}
+
+//Random edits of a good file, most of which break it somewhere
+void test_edits()
+{
+    const std::string joint = "<joint><id>%</id><color><red>1</red><green>2.5</green><blue>0.25</blue></color>"
+            "<size><height>5</height><radius>1</radius></size><axis><u>0.1</u><v>-0.2</v></axis></joint>\n";
+    std::string good = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<joints>\n";
+    for (int i = 1; i <= 3; i++)
+    {
+        std::string text = joint;
+        text.replace(text.find('%'), 1, std::to_string(i));
+        good += text;
+    }
+    good += "</joints>\n";
+
+    const char alphabet[] = "<>/a&;!?\" \n=j]-";
+    std::mt19937 random(25);
+    for (int k = 0; k < 1000; k++)
+    {
+        std::string text = good;
+        for (int edits = 1 + random() % 3; edits > 0 && !text.empty(); edits--)
+        {
+            std::size_t at = random() % text.size();
+            char c = alphabet[random() % (sizeof(alphabet)-1)];
+            switch (random() % 3)
+            {
+            case 0:
+                text.erase(at, 1);
+                break;
+            case 1:
+                text.insert(at, 1, c);
+                break;
+            default:
+                text[at] = c;
+            }
+        }
+        check_same(text);
+    }
+}
+
+}
+
+int main()
+{
+    test_cases();
+    test_edits();
+    QFile::remove(filename);
+    return test_result();
+}
@@ -0,0 +1,687 @@
+//-------------------------------------------------------
+// Filename: xmlloader.cpp
+//
+// Description: Fast loader for joints files.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include "xmlloader.h"
+#include "trace.h"
+#include <cerrno>
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+//Every element name the loader cares about, anything else is NAME_OTHER
+enum ElementName
+{
+    NAME_OTHER,
+    NAME_JOINTS,
+    NAME_JOINT,
+    NAME_ID,
+    NAME_COLOR,
+    NAME_RED,
+    NAME_GREEN,
+    NAME_BLUE,
+    NAME_SIZE,
+    NAME_HEIGHT,
+    NAME_RADIUS,
+    NAME_AXIS,
+    NAME_U,
+    NAME_V
+};
+
+inline bool same(const char *s, std::size_t n, const char *name)
+{
+    return std::memcmp(s, name, n) == 0;
+}
+
+//The length picks at most three candidates, so no name costs more than
+//three short compares
+ElementName intern(const char *s, std::size_t n)
+{
+    switch (n)
+    {
+    case 1:
+        if (*s == 'u')
+            return NAME_U;
+        if (*s == 'v')
+            return NAME_V;
+        break;
+    case 2:
+        if (same(s, n, "id"))
+            return NAME_ID;
+        break;
+    case 3:
+        if (same(s, n, "red"))
+            return NAME_RED;
+        break;
+    case 4:
+        if (same(s, n, "size"))
+            return NAME_SIZE;
+        if (same(s, n, "axis"))
+            return NAME_AXIS;
+        if (same(s, n, "blue"))
+            return NAME_BLUE;
+        break;
+    case 5:
+        if (same(s, n, "joint"))
+            return NAME_JOINT;
+        if (same(s, n, "color"))
+            return NAME_COLOR;
+        if (same(s, n, "green"))
+            return NAME_GREEN;
+        break;
+    case 6:
+        if (same(s, n, "joints"))
+            return NAME_JOINTS;
+        if (same(s, n, "height"))
+            return NAME_HEIGHT;
+        if (same(s, n, "radius"))
+            return NAME_RADIUS;
+        break;
+    }
+    return NAME_OTHER;
+}
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+//Start of needle in [begin, end), or end
+const char *find(const char *begin, const char *end, const char *needle)
+{
+    std::size_t n = std::strlen(needle);
+    while (end - begin >= std::ptrdiff_t(n))
+    {
+        const char *p = static_cast<const char*>(std::memchr(begin, needle[0], end - begin - n + 1));
+        if (!p)
+            break;
+        if (std::memcmp(p, needle, n) == 0)
+            return p;
+        begin = p+1;
+    }
+    return end;
+}
+
+inline bool starts_with(const char *begin, const char *end, const char *prefix)
+{
+    std::size_t n = std::strlen(prefix);
+    return std::size_t(end - begin) >= n && std::memcmp(begin, prefix, n) == 0;
+}
+
+//What each byte may be. Names are plain ASCII only, and text is printable
+//ASCII without references or ']'; anything else is left to QXmlStreamReader.
+enum CharClass
+{
+    CHAR_SPACE = 1,
+    CHAR_TEXT = 2,
+    CHAR_NAME_START = 4,
+    CHAR_NAME = 8
+};
+
+struct CharTable
+{
+    unsigned char classes[256];
+
+    CharTable()
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':';
+            bool name = letter || (c >= '0' && c <= '9') || c == '-' || c == '.';
+            classes[c] = (is_space(char(c)) ? CHAR_SPACE : 0) |
+                    (c >= 0x20 && c < 0x7F && c != '&' && c != ']' ? CHAR_TEXT : 0) |
+                    (letter ? CHAR_NAME_START : 0) | (name ? CHAR_NAME : 0);
+        }
+    }
+};
+
+const CharTable char_table;
+
+inline bool has_class(char c, int mask)
+{
+    return char_table.classes[static_cast<unsigned char>(c)] & mask;
+}
+
+//Whether [begin, end) is text QXmlStreamReader takes as it is, where only
+//whitespace is allowed outside the root
+bool plain_text(const char *begin, const char *end, bool in_root)
+{
+    int mask = in_root ? CHAR_SPACE | CHAR_TEXT : CHAR_SPACE;
+    for (const char *p = begin; p < end; p++)
+    {
+        if (!has_class(*p, mask))
+            return false;
+    }
+    return true;
+}
+
+void trim(const char *&begin, const char *&end)
+{
+    while (begin < end && is_space(*begin))
+        begin++;
+    while (end > begin && is_space(end[-1]))
+        end--;
+}
+
+//Case insensitive compare of [begin, end) with a lower case word
+bool same_word(const char *begin, const char *end, const char *word)
+{
+    for (; begin < end && *word; begin++, word++)
+    {
+        char c = *begin >= 'A' && *begin <= 'Z' ? *begin - 'A' + 'a' : *begin;
+        if (c != *word)
+            return false;
+    }
+    return begin == end && !*word;
+}
+
+//Slow path for numbers the fast path cannot round exactly. strtod reads the
+//decimal point of the C locale, so swap it in for '.'. Qt takes "inf" with a
+//sign and "nan" without one, and turns down numbers out of double range.
+bool parse_double_slow(const char *begin, const char *end, double &value)
+{
+    const char *digits = begin < end && (*begin == '-' || *begin == '+') ? begin+1 : begin;
+    if (same_word(digits, end, "inf"))
+    {
+        value = *begin == '-' ? -HUGE_VAL : HUGE_VAL;
+        return true;
+    }
+    if (same_word(begin, end, "nan"))
+    {
+        value = std::numeric_limits<double>::quiet_NaN();
+        return true;
+    }
+
+    char buffer[128];
+    std::size_t n = end - begin;
+    if (n == 0 || n >= sizeof(buffer))
+        return false;
+    char point = *std::localeconv()->decimal_point;
+    for (std::size_t k = 0; k < n; k++)
+    {
+        char c = begin[k];
+        //Qt takes no hexadecimal, no other decimal point and no other words
+        if (!is_digit(c) && c != '.' && c != 'e' && c != 'E' && c != '-' && c != '+')
+            return false;
+        buffer[k] = c == '.' ? point : c;
+    }
+    buffer[n] = 0;
+    char *stop;
+    errno = 0;
+    double d = std::strtod(buffer, &stop);
+    if (stop != buffer+n)
+        return false;
+    //Overflow, or underflow all the way to zero
+    if (errno == ERANGE && (d == 0 || std::isinf(d)))
+        return false;
+    value = d;
+    return true;
+}
+
+}
+
+bool parse_double(const char *begin, const char *end, double &value)
+{
+    trim(begin, end);
+    const char *p = begin;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    //Decimal mantissa and exponent, as long as the mantissa fits 19 digits
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    for (; p < end && is_digit(*p); p++, any = true)
+    {
+        if (mantissa == 0 && *p == '0')
+            continue;
+        if (digits++ < 19)
+            mantissa = 10*mantissa + (*p - '0');
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && is_digit(*p); p++, any = true)
+        {
+            if (mantissa == 0 && *p == '0')
+            {
+                exponent--;
+                continue;
+            }
+            if (digits++ < 19)
+            {
+                mantissa = 10*mantissa + (*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (any && p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p+1;
+        bool exponent_negative = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            exponent_negative = *q++ == '-';
+        if (q < end && is_digit(*q))
+        {
+            int e = 0;
+            for (; q < end && is_digit(*q); q++)
+            {
+                if (e < 10000)
+                    e = 10*e + (*q - '0');
+            }
+            exponent += exponent_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    //Both mantissa and power of ten are exact doubles here, so one multiply or
+    //divide rounds correctly. Everything else goes through strtod.
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (!any || p != end || digits > 19 || mantissa > (std::uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+        return parse_double_slow(begin, end, value);
+
+    double d = double(mantissa);
+    if (exponent < 0)
+        d /= powers[-exponent];
+    else
+        d *= powers[exponent];
+    value = negative ? -d : d;
+    return true;
+}
+
+bool parse_int(const char *begin, const char *end, int &value)
+{
+    trim(begin, end);
+    const char *p = begin;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    if (p == end)
+        return false;
+
+    //Magnitude of the most negative int is one more than the largest
+    long long limit = negative ? 2147483648LL : 2147483647LL;
+    long long n = 0;
+    for (; p < end; p++)
+    {
+        if (!is_digit(*p))
+            return false;
+        n = 10*n + (*p - '0');
+        if (n > limit)
+            return false;
+    }
+    value = static_cast<int>(negative ? -n : n);
+    return true;
+}
+
+struct XmlLoader::Tag
+{
+    int name;
+    bool end;
+    bool empty;
+};
+
+XmlLoader::XmlLoader(JointStore &joints):
+    mJoints{&joints},
+    mBegin{0},
+    mPos{0},
+    mEnd{0},
+    mStatus{XML_LOAD_OK}
+{}
+
+const std::string &XmlLoader::error_string() const
+{
+    return mError;
+}
+
+XmlLoadStatus XmlLoader::load(const char *data, std::size_t size)
+{
+    TRACE_SCOPE("xml_load");
+    mBegin = data;
+    mPos = data;
+    mEnd = data+size;
+    mStatus = XML_LOAD_OK;
+    mError.clear();
+    mOpen.clear();
+
+    //UTF-8 byte order mark, not counted in error columns, then the
+    //declaration XmlWriter writes
+    if (starts_with(mPos, mEnd, "\xEF\xBB\xBF"))
+    {
+        mPos += 3;
+        mBegin = mPos;
+    }
+    static const char *declarations[] = {"<?xml version=\"1.0\" encoding=\"UTF-8\"?>", "<?xml version=\"1.0\"?>"};
+    for (const char *declaration : declarations)
+    {
+        if (starts_with(mPos, mEnd, declaration))
+        {
+            mPos += std::strlen(declaration);
+            break;
+        }
+    }
+
+    Tag tag;
+    if (!next_tag(tag))
+        return mStatus;
+    if (tag.end || tag.name != NAME_JOINTS)
+    {
+        fail("Not a Joints File");
+        return mStatus;
+    }
+    if (tag.empty)
+    {
+        fail("Missing Parameter");
+        return mStatus;
+    }
+    //XmlReader stops at the end of the root, so whatever follows it is not read
+    read_joints();
+    return mStatus;
+}
+
+//Moves past the next start or end tag, skipping text and comments on the
+//way. Anything this loader does not check as strictly as QXmlStreamReader
+//does, including every kind of malformed XML, is left to XmlReader: the load
+//is marked unsupported and false returned.
+bool XmlLoader::next_tag(Tag &tag)
+{
+    while (true)
+    {
+        //Between tags there is mostly indentation, too short for memchr to pay
+        int mask = mOpen.empty() ? CHAR_SPACE : CHAR_SPACE | CHAR_TEXT;
+        while (mPos < mEnd && *mPos != '<' && has_class(*mPos, mask))
+            mPos++;
+        if (mPos == mEnd || *mPos != '<')
+        {
+            unsupported();
+            return false;
+        }
+
+        if (starts_with(mPos, mEnd, "<!--"))
+        {
+            //"--" may only appear as the end of the comment
+            const char *close = find(mPos+4, mEnd, "--");
+            if (close+2 >= mEnd || close[2] != '>' || !plain_text(mPos+4, close, true))
+            {
+                unsupported();
+                return false;
+            }
+            mPos = close+3;
+            continue;
+        }
+
+        const char *p = mPos+1;
+        tag.end = p < mEnd && *p == '/';
+        if (tag.end)
+            p++;
+        const char *name = p;
+        if (p < mEnd && has_class(*p, CHAR_NAME_START))
+        {
+            for (p++; p < mEnd && has_class(*p, CHAR_NAME); p++)
+                ;
+        }
+        std::size_t length = p - name;
+        while (p < mEnd && is_space(*p))
+            p++;
+        tag.empty = !tag.end && p < mEnd && *p == '/';
+        if (tag.empty)
+            p++;
+        //Declarations, DOCTYPE, CDATA, attributes and bad names
+        if (length == 0 || p == mEnd || *p != '>')
+        {
+            unsupported();
+            return false;
+        }
+        tag.name = intern(name, length);
+
+        //Every end tag has to close the innermost open element
+        if (tag.end)
+        {
+            if (mOpen.empty() || mOpen.back().length != length || !same(mOpen.back().name, length, name))
+            {
+                unsupported();
+                return false;
+            }
+            mOpen.pop_back();
+        }
+        else if (!tag.empty)
+        {
+            OpenElement element = {name, length};
+            mOpen.push_back(element);
+        }
+        mPos = p+1;
+        return true;
+    }
+}
+
+//Skips the element whose start tag was just read, with everything in it
+bool XmlLoader::skip_element()
+{
+    int depth = 1;
+    Tag tag;
+    while (depth > 0)
+    {
+        if (!next_tag(tag))
+            return false;
+        if (tag.end)
+            depth--;
+        else if (!tag.empty)
+            depth++;
+    }
+    return true;
+}
+
+bool XmlLoader::read_joints()
+{
+    bool joint{false};
+    Tag tag;
+    while (true)
+    {
+        if (!next_tag(tag))
+            return false;
+        if (tag.end)
+            break;
+        if (tag.name == NAME_JOINT)
+        {
+            if (!read_joint(tag.empty))
+                return false;
+            joint = true;
+        }
+        else if (!tag.empty && !skip_element())
+            return false;
+    }
+    if (!joint)
+    {
+        fail("Missing Parameter");
+        return false;
+    }
+    return true;
+}
+
+bool XmlLoader::read_joint(bool empty)
+{
+    static const int color_names[] = {NAME_RED, NAME_GREEN, NAME_BLUE};
+    static const int size_names[] = {NAME_HEIGHT, NAME_RADIUS};
+    static const int axis_names[] = {NAME_U, NAME_V};
+
+    int id{0};
+    double color[3] = {0, 0, 0};
+    double size[2] = {0, 0};
+    double axis[2] = {0, 0};
+    bool ok[3];
+
+    Tag tag;
+    while (!empty)
+    {
+        if (!next_tag(tag))
+            return false;
+        if (tag.end)
+            break;
+
+        if (tag.name == NAME_ID)
+        {
+            const char *begin, *end;
+            if (!read_text(tag.empty, begin, end))
+                return false;
+            if (!parse_int(begin, end, id))
+            {
+                fail("Missing joint ID");
+                return false;
+            }
+        }
+        else if (tag.name == NAME_COLOR)
+        {
+            if (!read_values(tag.empty, color_names, color, ok, 3))
+                return false;
+            if (!ok[0] || !ok[1] || !ok[2])
+            {
+                fail("Missing Color Parameter");
+                return false;
+            }
+        }
+        else if (tag.name == NAME_SIZE)
+        {
+            if (!read_values(tag.empty, size_names, size, ok, 2))
+                return false;
+            if (!ok[0] || !ok[1])
+            {
+                fail("Missing Size Paramter");
+                return false;
+            }
+        }
+        else if (tag.name == NAME_AXIS)
+        {
+            if (!read_values(tag.empty, axis_names, axis, ok, 2))
+                return false;
+            if (!ok[0] || !ok[1])
+            {
+                fail("Missing Axis Paramter");
+                return false;
+            }
+        }
+        else if (!tag.empty && !skip_element())
+            return false;
+    }
+
+    std::size_t i = mJoints->size();
+    mJoints->push_back(id, size[0], size[1]);
+    mJoints->set_color(i, color[0], color[1], color[2]);
+    mJoints->set_axis(i, axis[0], axis[1]);
+    return true;
+}
+
+//Reads the children of a color, size or axis element. values[k] is set from
+//the child named names[k], and ok[k] says whether it held a number; a child
+//given twice counts the last time, as in XmlReader.
+bool XmlLoader::read_values(bool empty, const int *names, double *values, bool *ok, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        values[k] = 0;
+        ok[k] = false;
+    }
+
+    Tag tag;
+    while (!empty)
+    {
+        if (!next_tag(tag))
+            return false;
+        if (tag.end)
+            break;
+
+        int k = 0;
+        while (k < count && names[k] != tag.name)
+            k++;
+        if (k == count)
+        {
+            if (!tag.empty && !skip_element())
+                return false;
+            continue;
+        }
+
+        const char *begin, *end;
+        if (!read_text(tag.empty, begin, end))
+            return false;
+        values[k] = 0;
+        ok[k] = parse_double(begin, end, values[k]);
+    }
+    return true;
+}
+
+//Text of the element whose start tag was just read, up to its end tag. The
+//text is left in place in the data.
+bool XmlLoader::read_text(bool empty, const char *&begin, const char *&end)
+{
+    begin = mPos;
+    end = mPos;
+    if (empty)
+        return true;
+
+    const char *open = static_cast<const char*>(std::memchr(mPos, '<', mEnd - mPos));
+    if (!open || !plain_text(begin, open, true))
+    {
+        unsupported();
+        return false;
+    }
+    end = open;
+    mPos = open;
+
+    //Comments or child elements inside the text
+    Tag tag;
+    if (!next_tag(tag))
+        return false;
+    if (!tag.end)
+    {
+        unsupported();
+        return false;
+    }
+    return true;
+}
+
+void XmlLoader::fail(const char *message)
+{
+    if (mStatus != XML_LOAD_OK)
+        return;
+    mStatus = XML_LOAD_ERROR;
+
+    //Line and column are only counted when something went wrong. Columns start
+    //at 0, as in QXmlStreamReader.
+    int line = 1;
+    int column = 0;
+    for (const char *p = mBegin; p < mPos && p < mEnd; p++)
+    {
+        if (*p == '\n')
+        {
+            line++;
+            column = 0;
+        }
+        else
+            column++;
+    }
+    mError = std::string(message) + "\nLine " + std::to_string(line) + ", column " + std::to_string(column);
+}
+
+void XmlLoader::unsupported()
+{
+    if (mStatus == XML_LOAD_OK)
+        mStatus = XML_LOAD_UNSUPPORTED;
+}
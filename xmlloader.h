@@ -0,0 +1,80 @@
+//-------------------------------------------------------
+// Filename: xmlloader.h
+//
+// Description: Fast loader for joints files. Reads the
+//              file straight from memory into a JointStore,
+//              without Qt and without building any nodes.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#ifndef XMLLOADER_H
+#define XMLLOADER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "jointstore.h"
+
+enum XmlLoadStatus
+{
+    XML_LOAD_OK,
+    //The file is not a valid joints file, error_string() says why
+    XML_LOAD_ERROR,
+    //The file is not well formed or uses XML this loader does not handle
+    //(declarations other than XmlWriter's, DOCTYPE, CDATA, attributes,
+    //references or non-ASCII text), read it with XmlReader instead
+    XML_LOAD_UNSUPPORTED
+};
+
+//Accepts the same files as XmlReader and reports the same errors, at the same
+//line and column; anything it cannot be sure of is XML_LOAD_UNSUPPORTED, so
+//that XmlReader reports it. Like XmlReader it stops at the end of the root.
+//Element names are matched once each to a fixed set of tokens, and numbers are
+//parsed in place, independent of the C locale. On failure the store keeps the
+//joints read before the problem.
+class XmlLoader
+{
+public:
+    XmlLoader(JointStore &joints);
+    XmlLoadStatus load(const char *data, std::size_t size);
+    //Message, line and column of the last XML_LOAD_ERROR
+    const std::string &error_string() const;
+
+private:
+    struct Tag;
+
+    //Name of an element read into, pointing into the data being loaded
+    struct OpenElement
+    {
+        const char *name;
+        std::size_t length;
+    };
+
+    bool next_tag(Tag &tag);
+    bool skip_element();
+    bool read_joints();
+    bool read_joint(bool empty);
+    bool read_values(bool empty, const int *names, double *values, bool *ok, int count);
+    bool read_text(bool empty, const char *&begin, const char *&end);
+    void fail(const char *message);
+    void unsupported();
+
+    JointStore *mJoints;
+    const char *mBegin;
+    const char *mPos;
+    const char *mEnd;
+    XmlLoadStatus mStatus;
+    std::string mError;
+    //Names of the elements read into but not yet closed, root first
+    std::vector<OpenElement> mOpen;
+};
+
+//Locale independent number parsing of the whole of [begin, end), surrounding
+//whitespace allowed, with the same results as QString::toDouble and toInt.
+//Numbers out of double range are turned down, as Qt does.
+bool parse_double(const char *begin, const char *end, double &value);
+bool parse_int(const char *begin, const char *end, int &value);
+
+#endif // XMLLOADER_H
@@ -0,0 +1,209 @@
+//-------------------------------------------------------
+// Filename: xmlloader_test.cpp
+//
+// Description: Checks the fast joints file loader: numbers
+//              against strtod bit for bit, malformed XML
+//              left to XmlReader, and errors reported where
+//              QXmlStreamReader reports them.
+//
+// Creators:  Matthew Ricks & Ryker Haddock
+//
+// Creation Date: 11/9/2017
+//-------------------------------------------------------
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include "testing.h"
+#include "xmlloader.h"
+
+namespace {
+
+bool parse(const std::string &text, double &value)
+{
+    return parse_double(text.data(), text.data()+text.size(), value);
+}
+
+bool same_bits(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+//Every number strtod reads within double range has to come out bit for bit
+//the same, on both the fast and the slow path
+void check_against_strtod(const std::string &text)
+{
+    errno = 0;
+    char *stop;
+    double expected = std::strtod(text.c_str(), &stop);
+    bool in_range = !(errno == ERANGE && (expected == 0 || std::isinf(expected)));
+    double value = 0;
+    bool ok = parse(text, value);
+    if (!CHECK(ok == in_range))
+        std::printf("  %s\n", text.c_str());
+    else if (ok && !CHECK(same_bits(value, expected)))
+        std::printf("  %s: %.17g, strtod %.17g\n", text.c_str(), value, expected);
+}
+
+void test_parse_double()
+{
+    std::mt19937_64 random(25);
+    std::uniform_real_distribution<double> uniform(-1e6, 1e6);
+    std::uniform_int_distribution<int> exponent(-340, 330);
+    std::uniform_int_distribution<int> digits(1, 30);
+    std::uniform_int_distribution<int> digit(0, 9);
+    char buffer[64];
+    for (int k = 0; k < 20000; k++)
+    {
+        //Round trips, short decimals, long mantissas and far exponents
+        switch (k % 4)
+        {
+        case 0:
+            std::snprintf(buffer, sizeof(buffer), "%.17g", uniform(random));
+            break;
+        case 1:
+            std::snprintf(buffer, sizeof(buffer), "%.*f", k % 7, uniform(random));
+            break;
+        case 2:
+        {
+            std::string text;
+            for (int n = digits(random); n > 0; n--)
+                text += char('0' + digit(random));
+            text += '.';
+            for (int n = digits(random); n > 0; n--)
+                text += char('0' + digit(random));
+            std::snprintf(buffer, sizeof(buffer), "%s", text.c_str());
+            break;
+        }
+        default:
+            std::snprintf(buffer, sizeof(buffer), "%de%d", int(random() % 100000000), exponent(random));
+        }
+        check_against_strtod(buffer);
+    }
+
+    const char *edges[] = {"0", "-0", "1e22", "1e23", "9007199254740992", "9007199254740993",
+                           "4.9e-324", "2e-324", "1e-400", "1.7976931348623157e308",
+                           "1.7976931348623159e308", "1e400", "0e999", "5.", ".5", "+4"};
+    for (const char *text : edges)
+        check_against_strtod(text);
+
+    //What QString::toDouble takes that strtod would read differently
+    double value = 0;
+    CHECK(parse(" 2.5\n", value) && value == 2.5);
+    CHECK(parse("-INF", value) && std::isinf(value) && value < 0);
+    CHECK(parse("nan", value) && std::isnan(value));
+    CHECK(!parse("-nan", value));
+    CHECK(!parse("infinity", value));
+    CHECK(!parse("0x10", value));
+    CHECK(!parse("1,5", value));
+    CHECK(!parse("1 5", value));
+    CHECK(!parse("", value));
+}
+
+XmlLoadStatus load(const std::string &text, JointStore &joints, std::string &error)
+{
+    XmlLoader loader(joints);
+    XmlLoadStatus status = loader.load(text.data(), text.size());
+    error = loader.error_string();
+    return status;
+}
+
+void test_malformed()
+{
+    //Each is not well formed, so XmlReader has to read it and say why
+    const char *texts[] = {
+        "<joints><joint><id>1</foo></joint></joints>",
+        "<joints><joint><id>1</id></jointx>",
+        "<joints><joint><extra><a></b></extra></joint></joints>",
+        "<joints><joint><id>1</id></joint>",
+        "<joints><joint><id a=\"1\">1</id></joint></joints>",
+        "<joints><joint><id>1&amp;</id></joint></joints>",
+        "<?xml version=\"2.0\"?><joints><joint/></joints>",
+        "text<joints><joint/></joints>",
+        "<!DOCTYPE joints><joints><joint/></joints>",
+        "<joints><joint><id>1<x/></id></joint></joints>",
+        "<joints><!-- a -- b --><joint/></joints>",
+        "<joints><1joint/></joints>"
+    };
+    for (const char *text : texts)
+    {
+        JointStore joints;
+        std::string error;
+        if (!CHECK(load(text, joints, error) == XML_LOAD_UNSUPPORTED))
+            std::printf("  %s\n", text);
+    }
+}
+
+void test_after_root()
+{
+    //XmlReader never reads past the end of the root
+    JointStore joints;
+    std::string error;
+    CHECK(load("<joints><joint><id>4</id></joint></joints>garbage <x> </y> & <", joints, error) == XML_LOAD_OK);
+    CHECK(joints.size() == 1 && joints.get_id(0) == 4);
+}
+
+void test_values()
+{
+    std::string text = "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n<joints>\r\n"
+            "  <!-- first -->\r\n  <joint>\r\n    <id> 7 </id>\r\n"
+            "    <color><red>255</red><green>0.5</green><blue>1e2</blue></color>\r\n"
+            "    <size><height>5.25</height><radius>1</radius><other/></size>\r\n"
+            "    <axis><u>-0.125</u><v>inf</v></axis>\r\n  </joint>\r\n  <joint/>\r\n</joints>\r\n";
+    JointStore joints;
+    std::string error;
+    CHECK(load(text, joints, error) == XML_LOAD_OK);
+    if (!CHECK(joints.size() == 2))
+        return;
+    double a, b, c;
+    CHECK(joints.get_id(0) == 7);
+    joints.get_color(0, a, b, c);
+    CHECK(a == 255 && b == 0.5 && c == 100);
+    joints.get_size(0, a, b);
+    CHECK(a == 5.25 && b == 1);
+    joints.get_axis(0, a, b);
+    CHECK(a == -0.125 && std::isinf(b));
+    CHECK(joints.get_id(1) == 0);
+}
+
+void test_errors()
+{
+    //Messages, lines and columns as QXmlStreamReader gives them in XmlReader
+    struct Case
+    {
+        const char *text;
+        const char *error;
+    };
+    const Case cases[] = {
+        {"<joints><joint><id>x</id></joint></joints>", "Missing joint ID\nLine 1, column 25"},
+        {"<joints>\n<joint><color><red>1</red><green>2</green></color></joint>\n</joints>",
+         "Missing Color Parameter\nLine 2, column 50"},
+        {"<joints><other/></joints>", "Missing Parameter\nLine 1, column 25"},
+        {"<?xml version=\"1.0\"?>\n<foo/>", "Not a Joints File\nLine 2, column 6"},
+        {"<joints><joint><size><height>1e400</height><radius>1</radius></size></joint></joints>",
+         "Missing Size Paramter\nLine 1, column 68"}
+    };
+    for (const Case &item : cases)
+    {
+        JointStore joints;
+        std::string error;
+        CHECK(load(item.text, joints, error) == XML_LOAD_ERROR);
+        if (!CHECK(error == item.error))
+            std::printf("  %s\n", error.c_str());
+    }
+}
+
+}
+
+int main()
+{
+    test_parse_double();
+    test_malformed();
+    test_after_root();
+    test_values();
+    test_errors();
+    return test_result();
+}
@@ -8,23 +8,51 @@
 // Creation Date: 11/9/2017
 //-------------------------------------------------------
 #include "xmlreader.h"
+#include "trace.h"
+#include "xmlloader.h"
 #include <QString>
-#include <list>
 
-XmlReader::XmlReader(std::list<Joint*> &linkedlist):
-    mLinkedList{&linkedlist}
+XmlReader::XmlReader(JointStore &joints):
+    mJoints{&joints}
 {}
 
 QString XmlReader::errorString() const
 {
+    if (!mLoadError.isEmpty())
+        return mLoadError;
     return QObject::tr("%1\nLine %2, column %3")
             .arg(mReader.errorString())
             .arg(mReader.lineNumber())
             .arg(mReader.columnNumber());
 }
 
+bool XmlReader::read(QFile *file)
+{
+    mLoadError.clear();
+    qint64 size = file->size() - file->pos();
+    uchar *data = size > 0 ? file->map(file->pos(), size) : 0;
+    if (!data)
+        return read(static_cast<QIODevice*>(file));
+
+    std::size_t first = mJoints->size();
+    XmlLoader loader(*mJoints);
+    XmlLoadStatus status = loader.load(reinterpret_cast<const char*>(data), size);
+    file->unmap(data);
+    if (status == XML_LOAD_ERROR)
+        mLoadError = QString::fromStdString(loader.error_string());
+    if (status != XML_LOAD_UNSUPPORTED)
+        return status == XML_LOAD_OK;
+
+    //Drop what the loader read before it gave up and start over
+    while (mJoints->size() > first)
+        mJoints->erase(mJoints->size()-1);
+    return read(static_cast<QIODevice*>(file));
+}
+
 bool XmlReader::read(QIODevice *device)
 {
+    TRACE_SCOPE("xml_read");
+    mLoadError.clear();
     mReader.setDevice(device);
 
     if (mReader.readNextStartElement()) {
@@ -57,7 +85,7 @@ void XmlReader::read_joint()
 {
     int id{0};
     Vector3 color;
-    double size1, size2, axis1, axis2;
+    double size1{0}, size2{0}, axis1{0}, axis2{0};
 
     while (mReader.readNextStartElement())
     {
@@ -72,10 +100,10 @@ void XmlReader::read_joint()
         else
             mReader.skipCurrentElement();
     }
-    Joint* joint = new Joint(id,size1,size2);
-    joint->set_color(color.mX,color.mY,color.mZ);
-    joint->set_axis(axis1,axis2);
-    mLinkedList->push_back(joint);
+    mJoints->push_back(id,size1,size2);
+    std::size_t i = mJoints->size()-1;
+    mJoints->set_color(i,color.mX,color.mY,color.mZ);
+    mJoints->set_axis(i,axis1,axis2);
 }
 
 void XmlReader::read_id(int &id)
@@ -9,22 +9,27 @@
 //-------------------------------------------------------
 #ifndef XMLREADER_H
 #define XMLREADER_H
+#include <QFile>
 #include <QIODevice>
 #include <QXmlStreamReader>
 #include <QString>
-#include <list>
-#include "joint.h"
+#include "jointstore.h"
 
 class XmlReader
 {
 public:
-    XmlReader(std::list<Joint*> &linkedlist);
+    XmlReader(JointStore &joints);
     bool read(QIODevice *device);
+    //Maps the file and reads it with XmlLoader, falling back to read() for
+    //files the fast loader does not handle
+    bool read(QFile *file);
     QString errorString() const;
 
 protected:
     QXmlStreamReader mReader;
-    std::list<Joint*> *mLinkedList;
+    JointStore *mJoints;
+    //Error from XmlLoader, empty when the last error came from mReader
+    QString mLoadError;
 
     struct Vector3
     {
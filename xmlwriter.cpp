@@ -8,15 +8,16 @@
 // Creation Date: 11/9/2017
 //-------------------------------------------------------
 #include "xmlwriter.h"
-#include<list>
+#include "trace.h"
 
-XmlWriter::XmlWriter(std::list<Joint*> &linkedlist):
-    mLinkedList{linkedlist}
+XmlWriter::XmlWriter(const JointStore &joints):
+    mJoints{&joints}
 {
 
 }
 void XmlWriter::write(QIODevice *device)
 {
+    TRACE_SCOPE("xml_write");
     mWriter.setDevice(device);
     mWriter.setAutoFormatting(true);
     mWriter.writeStartDocument();
@@ -30,14 +31,14 @@ void XmlWriter::write_joints()
 {
     mWriter.writeStartElement("joints");
 
-    for (std::list<Joint*>::iterator it=mLinkedList.begin(); it != mLinkedList.end(); it++)
+    for (std::size_t i = 0; i < mJoints->size(); i++)
     {
-        write_joint(*it);
+        write_joint(i);
     }
 
     mWriter.writeEndElement(); // joints
 }
-void XmlWriter::write_joint(Joint *joint)
+void XmlWriter::write_joint(std::size_t i)
 {
     mWriter.writeStartElement("joint");
 
@@ -45,10 +46,10 @@ void XmlWriter::write_joint(Joint *joint)
     Vector3 color;
     double size1, size2, axis1, axis2;
 
-    id=joint->get_id();
-    joint->get_color(color.mX,color.mY,color.mZ);
-    joint->get_size(size1,size2);
-    joint->get_axis(axis1,axis2);
+    id=mJoints->get_id(i);
+    mJoints->get_color(i,color.mX,color.mY,color.mZ);
+    mJoints->get_size(i,size1,size2);
+    mJoints->get_axis(i,axis1,axis2);
 
     write_id(id);
 
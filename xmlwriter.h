@@ -11,20 +11,17 @@
 #define XMLWRITER_H
 #include <QIODevice>
 #include <QXmlStreamWriter>
-#include<list>
-#include "xmlreader.h"
-
-class Joint;
+#include "jointstore.h"
 
 class XmlWriter
 {
 public:
-    XmlWriter(std::list<Joint*> &linkedlist);
+    XmlWriter(const JointStore &joints);
     void write(QIODevice *device);
 
 protected:
     QXmlStreamWriter mWriter;
-    std::list<Joint*> mLinkedList;
+    const JointStore *mJoints;
 
     struct Vector3
     {
@@ -35,7 +32,7 @@ protected:
 
     void write_size(double height, double radius);
     void write_joints();
-    void write_joint(Joint *joint);
+    void write_joint(std::size_t i);
     void write_id(int id);
     void write_xyz(Vector3 &vec);
     void write_color(Vector3 &color);